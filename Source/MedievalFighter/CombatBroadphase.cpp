@@ -0,0 +1,123 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "CombatBroadphase.h"
+#include "MedievalFighter.h"
+
+DECLARE_CYCLE_STAT(TEXT("Broadphase Update"), STAT_BroadphaseUpdate, STATGROUP_MedievalFighter);
+DECLARE_CYCLE_STAT(TEXT("Broadphase Query"), STAT_BroadphaseQuery, STATGROUP_MedievalFighter);
+
+namespace
+{
+	// One broadphase per world so PIE clients and the listen server don't see each other's fighters
+	TMap<const UWorld*, TUniquePtr<FCombatBroadphase>> WorldBroadphases;
+}
+
+FCombatBroadphase::FCombatBroadphase(float InCellSize, float InFighterExtent)
+	: CellSize(InCellSize)
+	, InvCellSize(1.0f / InCellSize)
+	, FighterExtent(InFighterExtent)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Registration
+//////////////////////////////////////////////////////////////////////////
+void FCombatBroadphase::Add(AMedievalFighterCharacter* Fighter, const FVector& Location)
+{
+	if (FighterCells.Contains(Fighter)) {
+		Update(Fighter, Location);
+		return;
+	}
+
+	const FIntPoint Cell = GetCell(Location);
+	FighterCells.Add(Fighter, Cell);
+	Cells.FindOrAdd(Cell).Add(Fighter);
+}
+void FCombatBroadphase::Remove(AMedievalFighterCharacter* Fighter)
+{
+	FIntPoint Cell;
+	if (FighterCells.RemoveAndCopyValue(Fighter, Cell)) {
+		FCell& Fighters = Cells.FindChecked(Cell);
+		Fighters.RemoveSingleSwap(Fighter, false);
+		if (Fighters.Num() == 0) {
+			Cells.Remove(Cell);
+		}
+	}
+}
+void FCombatBroadphase::Update(AMedievalFighterCharacter* Fighter, const FVector& Location)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BroadphaseUpdate);
+
+	FIntPoint* Cell = FighterCells.Find(Fighter);
+	if (Cell == nullptr) {
+		return;
+	}
+
+	const FIntPoint NewCell = GetCell(Location);
+	if (NewCell != *Cell) {
+		FCell& OldFighters = Cells.FindChecked(*Cell);
+		OldFighters.RemoveSingleSwap(Fighter, false);
+		if (OldFighters.Num() == 0) {
+			Cells.Remove(*Cell);
+		}
+
+		Cells.FindOrAdd(NewCell).Add(Fighter);
+		*Cell = NewCell;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Queries
+//////////////////////////////////////////////////////////////////////////
+void FCombatBroadphase::QueryBox(const FBox& Box, TArray<AMedievalFighterCharacter*>& OutFighters) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_BroadphaseQuery);
+
+	const FVector Extent(FighterExtent, FighterExtent, 0.0f);
+	QueryCells(GetCell(Box.Min - Extent), GetCell(Box.Max + Extent), OutFighters);
+}
+void FCombatBroadphase::QueryCells(const FIntPoint& Min, const FIntPoint& Max, TArray<AMedievalFighterCharacter*>& OutFighters) const
+{
+	const int64 CellsInRange = int64(Max.X - Min.X + 1) * int64(Max.Y - Min.Y + 1);
+
+	// Large queries are cheaper to answer by walking the occupied cells instead
+	if (CellsInRange > Cells.Num()) {
+		for (const TPair<FIntPoint, FCell>& Pair : Cells) {
+			if (Pair.Key.X >= Min.X && Pair.Key.X <= Max.X && Pair.Key.Y >= Min.Y && Pair.Key.Y <= Max.Y) {
+				OutFighters.Append(Pair.Value);
+			}
+		}
+		return;
+	}
+
+	for (int32 X = Min.X; X <= Max.X; X++) {
+		for (int32 Y = Min.Y; Y <= Max.Y; Y++) {
+			if (const FCell* Fighters = Cells.Find(FIntPoint(X, Y))) {
+				OutFighters.Append(*Fighters);
+			}
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Per world instances
+//////////////////////////////////////////////////////////////////////////
+FCombatBroadphase& FCombatBroadphase::Get(const UWorld* World)
+{
+	check(IsInGameThread());
+
+	TUniquePtr<FCombatBroadphase>& Broadphase = WorldBroadphases.FindOrAdd(World);
+	if (!Broadphase.IsValid()) {
+		Broadphase = MakeUnique<FCombatBroadphase>();
+	}
+	return *Broadphase;
+}
+void FCombatBroadphase::Release(const UWorld* World)
+{
+	check(IsInGameThread());
+
+	const TUniquePtr<FCombatBroadphase>* Broadphase = WorldBroadphases.Find(World);
+	if (Broadphase != nullptr && (*Broadphase)->Num() == 0) {
+		WorldBroadphases.Remove(World);
+	}
+}
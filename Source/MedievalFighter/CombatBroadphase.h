@@ -0,0 +1,56 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AMedievalFighterCharacter;
+class UWorld;
+
+/**
+ * Uniform 2D grid of fighters used as the combat broadphase.
+ * Swings query this instead of the physics scene, so only fighters are ever considered.
+ * Fighters are re-bucketed only when they cross a cell.
+ */
+class MEDIEVALFIGHTER_API FCombatBroadphase
+{
+public:
+	explicit FCombatBroadphase(float InCellSize = 200.0f, float InFighterExtent = 100.0f);
+
+	/** Adds a fighter at the given location */
+	void Add(AMedievalFighterCharacter* Fighter, const FVector& Location);
+	/** Removes a fighter */
+	void Remove(AMedievalFighterCharacter* Fighter);
+	/** Moves a fighter, touching the grid only when it changes cell */
+	void Update(AMedievalFighterCharacter* Fighter, const FVector& Location);
+
+	/** Collects every fighter whose hitbox may intersect the box */
+	void QueryBox(const FBox& Box, TArray<AMedievalFighterCharacter*>& OutFighters) const;
+
+	/** Returns number of registered fighters */
+	FORCEINLINE int32 Num() const { return FighterCells.Num(); }
+
+	/** Returns the broadphase of the given world, creating it on first use */
+	static FCombatBroadphase& Get(const UWorld* World);
+	/** Frees the broadphase of the given world once no fighters are left */
+	static void Release(const UWorld* World);
+
+private:
+	FORCEINLINE FIntPoint GetCell(const FVector& Location) const
+	{
+		return FIntPoint(FMath::FloorToInt(Location.X * InvCellSize), FMath::FloorToInt(Location.Y * InvCellSize));
+	}
+
+	void QueryCells(const FIntPoint& Min, const FIntPoint& Max, TArray<AMedievalFighterCharacter*>& OutFighters) const;
+
+	/** Size of one grid cell */
+	float CellSize;
+	float InvCellSize;
+	/** Furthest a fighter's hitbox reaches from its actor location */
+	float FighterExtent;
+
+	typedef TArray<AMedievalFighterCharacter*, TInlineAllocator<4>> FCell;
+
+	TMap<FIntPoint, FCell> Cells;
+	TMap<AMedievalFighterCharacter*, FIntPoint> FighterCells;
+};
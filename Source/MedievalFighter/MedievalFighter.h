@@ -3,3 +3,8 @@
 #pragma once
 
 #include "CoreMinimal.h"
+
+DECLARE_STATS_GROUP(TEXT("MedievalFighter"), STATGROUP_MedievalFighter, STATCAT_Advanced);
+
+/** Object channel of per-bone combat hitboxes, see DefaultEngine.ini */
+#define ECC_Hitbox ECC_GameTraceChannel1
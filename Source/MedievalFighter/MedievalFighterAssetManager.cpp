@@ -0,0 +1,26 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "MedievalFighterAssetManager.h"
+#include "MedievalFighterCharacter.h"
+#include "MedievalFighterGameMode.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMedievalFighterAssetManager, Log, All);
+
+#if WITH_EDITOR
+void UMedievalFighterAssetManager::ModifyCook(TArray<FName>& PackagesToCook, TArray<FName>& PackagesToNeverCook)
+{
+	Super::ModifyCook(PackagesToCook, PackagesToNeverCook);
+
+	// Weapon assets are soft references, nothing else pulls them into the cook
+	TArray<FSoftObjectPath> AssetPaths;
+	AMedievalFighterGameMode::GetFighterDefaults()->GetPreloadAssetPaths(AssetPaths);
+
+	for (const FSoftObjectPath& Path : AssetPaths) {
+		if (!Path.IsNull()) {
+			PackagesToCook.AddUnique(FName(*Path.GetLongPackageName()));
+		}
+	}
+
+	UE_LOG(LogMedievalFighterAssetManager, Log, TEXT("Added %d fighter assets to the cook"), AssetPaths.Num());
+}
+#endif
@@ -0,0 +1,21 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/AssetManager.h"
+#include "MedievalFighterAssetManager.generated.h"
+
+/** Cooks the fighter's preload manifest, read from the configured fighter class so it is only listed once */
+UCLASS()
+class UMedievalFighterAssetManager : public UAssetManager
+{
+	GENERATED_BODY()
+
+public:
+#if WITH_EDITOR
+	// UAssetManager interface
+	virtual void ModifyCook(TArray<FName>& PackagesToCook, TArray<FName>& PackagesToNeverCook) override;
+	// End of UAssetManager interface
+#endif
+};
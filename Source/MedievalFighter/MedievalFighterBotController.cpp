@@ -0,0 +1,8 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "MedievalFighterBotController.h"
+
+AMedievalFighterBotController::AMedievalFighterBotController()
+{
+	bWantsPlayerState = true;
+}
@@ -0,0 +1,17 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIController.h"
+#include "MedievalFighterBotController.generated.h"
+
+/** Bot with a player state, so its kills and deaths count towards scoring like a player's */
+UCLASS()
+class AMedievalFighterBotController : public AAIController
+{
+	GENERATED_BODY()
+
+public:
+	AMedievalFighterBotController();
+};
@@ -1,6 +1,10 @@
 // Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
 
 #include "MedievalFighterCharacter.h"
+#include "MedievalFighter.h"
+#include "CombatBroadphase.h"
+#include "MedievalFighterGameMode.h"
+#include "MedievalFighterMovementComponent.h"
 #include "Camera/CameraComponent.h"
 #include "Components/CapsuleComponent.h"
 #include "Components/InputComponent.h"
@@ -9,11 +13,18 @@
 #include "Engine.h"
 #include "Net/UnrealNetwork.h"
 #include "Animation/AnimInstance.h"
+#include "Animation/AnimMontage.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Swing Query"), STAT_SwingQuery, STATGROUP_MedievalFighter);
+DECLARE_CYCLE_STAT(TEXT("Weapon Swap"), STAT_WeaponSwap, STATGROUP_MedievalFighter);
 
 //////////////////////////////////////////////////////////////////////////
 // AMedievalFighterCharacter
 //////////////////////////////////////////////////////////////////////////
-AMedievalFighterCharacter::AMedievalFighterCharacter()
+AMedievalFighterCharacter::AMedievalFighterCharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UMedievalFighterMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
 	// Set size for collision capsule
 	GetCapsuleComponent()->InitCapsuleSize(42.f, 96.0f);
@@ -36,6 +47,11 @@ AMedievalFighterCharacter::AMedievalFighterCharacter()
 	// Health system
 	Health = 100.0f;
 
+	// Weapon swapping
+	WeaponSwapBlendTime = 0.15f;
+	WeaponSwapEndTime = 0.0f;
+	FPAttackMontage = nullptr;
+
 	// Create a first person camera
 	FPCamera = CreateDefaultSubobject<UCameraComponent>(TEXT("FollowCamera"));
 	FPCamera->SetupAttachment(GetMesh(), TEXT("Head"));
@@ -46,11 +62,13 @@ AMedievalFighterCharacter::AMedievalFighterCharacter()
 	// Create first person
 	GetMesh()->SetOnlyOwnerSee(true);
 	GetMesh()->SetCollisionProfileName(TEXT("NoCollision"));
+	GetMesh()->SetGenerateOverlapEvents(false);
 
 	FPWeaponMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("Weapon Mesh"));
 	FPWeaponMesh->SetupAttachment(GetMesh(), TEXT("hand_r"));
 	FPWeaponMesh->SetOnlyOwnerSee(true);
 	FPWeaponMesh->SetCollisionProfileName(TEXT("NoCollision"));
+	FPWeaponMesh->SetGenerateOverlapEvents(false);
 
 	// Create third person
 	TPMesh = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("Third Person Mesh"));
@@ -58,42 +76,66 @@ AMedievalFighterCharacter::AMedievalFighterCharacter()
 	TPMesh->SetRelativeLocation(FVector(0.0f, 0.0f, -97.0f));
 	TPMesh->SetRelativeRotation(FRotator(0.0f, -90.000717f, 0.0f));
 	TPMesh->SetOwnerNoSee(true);
-	TPMesh->SetCollisionProfileName(TEXT("BlockAll"));
+	// Hitboxes are ignored by every trace channel, the capsule handles movement collision.
+	// The reduced per-bone capsule asset is not authored yet, so these are still the full mannequin
+	// physics asset's bodies; set it as the Physics Asset Override in BP_Player once it exists
+	TPMesh->SetCollisionProfileName(TEXT("Hitbox"));
+	TPMesh->SetGenerateOverlapEvents(false);
 
 	TPWeaponMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("Third Person Weapon Mesh"));
 	TPWeaponMesh->SetupAttachment(TPMesh, TEXT("hand_r"));
 	TPWeaponMesh->SetOwnerNoSee(true);
 	TPWeaponMesh->SetCollisionProfileName(TEXT("NoCollision"));
-	TPWeaponMesh->OnComponentBeginOverlap.AddDynamic(this, &AMedievalFighterCharacter::WeaponMeshOverlap);
-
-	// Load weapon meshes
-	ConstructorHelpers::FObjectFinder<UStaticMesh>DaggerAssetFound(TEXT("StaticMesh'/Game/Player/WeaponPlaceholders/KnifeViking.KnifeViking'"));
-	DaggerAsset = DaggerAssetFound.Object;
-	ConstructorHelpers::FObjectFinder<UAnimMontage>DaggerAttackMontageFound(TEXT("AnimMontage'/Game/Player/Mannequin/Animations/Dagger/FPP_Dag_AttackLSlash_Montage.FPP_Dag_AttackLSlash_Montage'"));
-	DaggerAttackMontage = DaggerAttackMontageFound.Object;
-	ConstructorHelpers::FObjectFinder<UAnimMontage>DaggerDamageMontageFound(TEXT("AnimMontage'/Game/Player/Mannequin/Animations/Dagger/FPP_Dag_HitC_Montage.FPP_Dag_HitC_Montage'"));
-	DaggerDamageMontage = DaggerDamageMontageFound.Object;
-
-	ConstructorHelpers::FObjectFinder<UStaticMesh>HalberdAssetFound(TEXT("StaticMesh'/Game/Player/WeaponPlaceholders/BerdyszViking.BerdyszViking'"));
-	HalberdAsset = HalberdAssetFound.Object;
-	ConstructorHelpers::FObjectFinder<UAnimMontage>HalberdAttackMontageFound(TEXT("AnimMontage'/Game/Player/Mannequin/Animations/Halberd/FPP_Halb_Attack_D2_Montage.FPP_Halb_Attack_D2_Montage'"));
-	HalberdAttackMontage = HalberdAttackMontageFound.Object;
-	ConstructorHelpers::FObjectFinder<UAnimMontage>HalberdDamageMontageFound(TEXT("AnimMontage'/Game/Player/Mannequin/Animations/Halberd/FPP_Halb_Hit1_Montage.FPP_Halb_Hit1_Montage'"));
-	HalberdDamageMontage = HalberdDamageMontageFound.Object;
-
-	ConstructorHelpers::FObjectFinder<UStaticMesh>LongSwordAssetFound(TEXT("StaticMesh'/Game/Player/WeaponPlaceholders/Longsword.Longsword'"));
-	LongSwordAsset = LongSwordAssetFound.Object;
-	ConstructorHelpers::FObjectFinder<UAnimMontage>LongSwordAttackMontageFound(TEXT("AnimMontage'/Game/Player/Mannequin/Animations/Longsword/FPP_Longs_Attack_R_Montage.FPP_Longs_Attack_R_Montage'"));
-	LongSwordAttackMontage = LongSwordAttackMontageFound.Object;
-	ConstructorHelpers::FObjectFinder<UAnimMontage>LongSwordDamageMontageFound(TEXT("AnimMontage'/Game/Player/Mannequin/Animations/Longsword/FPP_Longs_Hit1_Montage.FPP_Longs_Hit1_Montage'"));
-	LongSwordDamageMontage = LongSwordDamageMontageFound.Object;
-
-	ConstructorHelpers::FObjectFinder<UStaticMesh>SpearAssetFound(TEXT("StaticMesh'/Game/Player/WeaponPlaceholders/SpearViking.SpearViking'"));
-	SpearAsset = SpearAssetFound.Object;
-	ConstructorHelpers::FObjectFinder<UAnimMontage>SpearAttackMontageFound(TEXT("AnimMontage'/Game/Player/Mannequin/Animations/Spear/FPPSpear_Attack1_Montage.FPPSpear_Attack1_Montage'"));
-	SpearAttackMontage = SpearAttackMontageFound.Object;
-	ConstructorHelpers::FObjectFinder<UAnimMontage>SpearDamageMontageFound(TEXT("AnimMontage'/Game/Player/Mannequin/Animations/Spear/FPPSpear_Hit1_Montage.FPPSpear_Hit1_Montage'"));
-	SpearDamageMontage = SpearDamageMontageFound.Object;
+	TPWeaponMesh->SetGenerateOverlapEvents(false);
+	// Keep a body for swing overlap tests without ever adding the weapon to scene queries
+	TPWeaponMesh->bAlwaysCreatePhysicsState = true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Actor
+//////////////////////////////////////////////////////////////////////////
+void AMedievalFighterCharacter::BeginPlay()
+{
+	Super::BeginPlay();
+
+	FCombatBroadphase::Get(GetWorld()).Add(this, GetActorLocation());
+}
+void AMedievalFighterCharacter::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	// BP_Player was saved while the weapon was still bound to the removed WeaponMeshOverlap handler
+	TPWeaponMesh->OnComponentBeginOverlap.Remove(this, TEXT("WeaponMeshOverlap"));
+}
+void AMedievalFighterCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	FCombatBroadphase::Get(GetWorld()).Remove(this);
+	FCombatBroadphase::Release(GetWorld());
+
+	Super::EndPlay(EndPlayReason);
+}
+void AMedievalFighterCharacter::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	FCombatBroadphase::Get(GetWorld()).Update(this, GetActorLocation());
+
+	// Only the owner and the server can report hits
+	if (bAttacking && (IsLocallyControlled() || HasAuthority())) {
+		QueryWeaponHits();
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Assets
+//////////////////////////////////////////////////////////////////////////
+void AMedievalFighterCharacter::GetPreloadAssetPaths(TArray<FSoftObjectPath>& OutPaths) const
+{
+	DaggerAssets.GetAssetPaths(OutPaths);
+	HalberdAssets.GetAssetPaths(OutPaths);
+	LongSwordAssets.GetAssetPaths(OutPaths);
+	SpearAssets.GetAssetPaths(OutPaths);
+	SwordAndShieldAssets.GetAssetPaths(OutPaths);
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -167,61 +209,17 @@ void AMedievalFighterCharacter::MoveRight(float Value)
 //////////////////////////////////////////////////////////////////////////
 void AMedievalFighterCharacter::SetWeapon(EWeapons WeaponToSet)
 {
-	if (!bAttacking) {
+	// Checked against local animation state so a swing that hasn't replicated yet still blocks the swap.
+	// The swap itself only starts from the multicast, so one the server refuses is never shown
+	if (!IsSwinging() && !IsSwappingWeapon() && !IsDead() && WeaponToSet != ActiveWeapon) {
 		SetWeaponServer(WeaponToSet);
-
-		switch (WeaponToSet) {
-			case EWeapons::W_NoWeapon:
-			{
-				FPWeaponMesh->SetRelativeLocation(FVector(0.0f, 0.0f, 0.0f));
-				FPWeaponMesh->SetRelativeRotation(FRotator(0.0f, 0.0f, 0.0f));
-				FPWeaponMesh->SetStaticMesh(NULL);
-				FPWeaponMesh->SetVisibility(false, false);
-			}
-				break;
-			case EWeapons::W_Dagger:
-			{
-				FPWeaponMesh->SetRelativeLocation(FVector(-8.781104f, 4.826352f, 0.126374f));
-				FPWeaponMesh->SetRelativeRotation(FRotator(4.980621f, 81.317833f, 119.621643f));
-				FPWeaponMesh->SetStaticMesh(DaggerAsset);
-				FPWeaponMesh->SetVisibility(true, false);
-			}
-				break;
-			case EWeapons::W_Halberd:
-			{
-				FPWeaponMesh->SetRelativeLocation(FVector(12.110796f, 5.220458f, -28.740444f));
-				FPWeaponMesh->SetRelativeRotation(FRotator(-9.99996f, -97.999985f, -124.999985f));
-				FPWeaponMesh->SetStaticMesh(HalberdAsset);
-				FPWeaponMesh->SetVisibility(true, false);
-			}
-				break;
-			case EWeapons::W_Longsword:
-			{
-				FPWeaponMesh->SetRelativeLocation(FVector(-8.573628f, 5.381995f, 0.508609f));
-				FPWeaponMesh->SetRelativeRotation(FRotator(0.000067f, 75.0f, -47.0f));
-				FPWeaponMesh->SetStaticMesh(LongSwordAsset);
-				FPWeaponMesh->SetVisibility(true, false);
-			}
-				break;
-			case EWeapons::W_Spear:
-			{
-				FPWeaponMesh->SetRelativeLocation(FVector(-12.062593f, 5.173286f, 1.960684f));
-				FPWeaponMesh->SetRelativeRotation(FRotator(2.0f, 82.0f, -43.0f));
-				FPWeaponMesh->SetStaticMesh(SpearAsset);
-				FPWeaponMesh->SetVisibility(true, false);
-			}
-				break;
-			default:
-				FPWeaponMesh->SetRelativeLocation(FVector(0.0f, 0.0f, 0.0f));
-				FPWeaponMesh->SetRelativeRotation(FRotator(0.0f, 0.0f, 0.0f));
-				FPWeaponMesh->SetStaticMesh(NULL);
-				FPWeaponMesh->SetVisibility(false, false);
-		}
 	}
 }
 void AMedievalFighterCharacter::SetWeaponServer_Implementation(EWeapons WeaponToSet)
 {
-	SetWeaponMulticast(WeaponToSet);
+	if (!bAttacking && !IsDead() && WeaponToSet != ActiveWeapon) {
+		SetWeaponMulticast(WeaponToSet);
+	}
 }
 bool AMedievalFighterCharacter::SetWeaponServer_Validate(EWeapons WeaponToSet)
 {
@@ -229,88 +227,218 @@ bool AMedievalFighterCharacter::SetWeaponServer_Validate(EWeapons WeaponToSet)
 }
 void AMedievalFighterCharacter::SetWeaponMulticast_Implementation(EWeapons WeaponToSet)
 {
+	const EWeapons PreviousWeapon = ActiveWeapon;
 	ActiveWeapon = WeaponToSet;
 
-	switch (WeaponToSet) {
-		case EWeapons::W_NoWeapon:
-		{
-			TPWeaponMesh->SetRelativeLocation(FVector(0.0f, 0.0f, 0.0f));
-			TPWeaponMesh->SetRelativeRotation(FRotator(0.0f, 0.0f, 0.0f));
-			TPWeaponMesh->SetStaticMesh(NULL);
-			TPWeaponMesh->SetVisibility(false, false);
+	RequestWeaponSwap(PreviousWeapon, WeaponToSet, false);
+	if (IsLocallyControlled()) {
+		RequestWeaponSwap(PreviousWeapon, WeaponToSet, true);
+	}
+}
+void AMedievalFighterCharacter::RequestWeaponSwap(EWeapons FromWeapon, EWeapons ToWeapon, bool bFirstPerson)
+{
+	// A newer swap replaces any load or equip still pending from the last one
+	TSharedPtr<FStreamableHandle>& LoadHandle = bFirstPerson ? FPWeaponLoadHandle : TPWeaponLoadHandle;
+	if (LoadHandle.IsValid()) {
+		if (LoadHandle->IsLoadingInProgress()) {
+			LoadHandle->CancelHandle();
 		}
-			break;
+		else {
+			LoadHandle->ReleaseHandle();
+		}
+		LoadHandle.Reset();
+	}
+	GetWorld()->GetTimerManager().ClearTimer(bFirstPerson ? FPWeaponSwapTimerHandle : TPWeaponSwapTimerHandle);
+
+	WeaponSwapEndTime = FMath::Max(WeaponSwapEndTime, GetWorld()->GetTimeSeconds() + WeaponSwapBlendTime);
+
+	TArray<FSoftObjectPath> MissingAssets;
+	if (const FWeaponAssets* Assets = GetWeaponAssets(ToWeapon)) {
+		Assets->GetAssetPaths(MissingAssets);
+	}
+	MissingAssets.RemoveAll([](const FSoftObjectPath& Path) { return Path.IsNull() || Path.ResolveObject() != nullptr; });
+
+	// Everything is normally resident from the preload manifest, otherwise stream it in instead of stalling
+	if (MissingAssets.Num() == 0) {
+		StartWeaponSwap(FromWeapon, ToWeapon, bFirstPerson);
+	}
+	else {
+		// Kept until the next swap, so the weapon's assets stay resident while it is held
+		LoadHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(MissingAssets, FStreamableDelegate::CreateUObject(this, &AMedievalFighterCharacter::StartWeaponSwap, FromWeapon, ToWeapon, bFirstPerson), FStreamableManager::AsyncLoadHighPriority);
+	}
+}
+void AMedievalFighterCharacter::StartWeaponSwap(EWeapons FromWeapon, EWeapons ToWeapon, bool bFirstPerson)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WeaponSwap);
+
+	// Another swap went through while this one was loading
+	if (ToWeapon != ActiveWeapon) {
+		return;
+	}
+
+	UAnimInstance* AnimInstance = (bFirstPerson ? GetMesh() : TPMesh)->GetAnimInstance();
+	FTimerHandle& SwapTimerHandle = bFirstPerson ? FPWeaponSwapTimerHandle : TPWeaponSwapTimerHandle;
+	float UnequipTime = 0.0f;
+
+	const FWeaponAssets* FromAssets = GetWeaponAssets(FromWeapon);
+	UAnimSequenceBase* UnequipAnimation = FromAssets != nullptr ? FromAssets->UnequipAnimation.Get() : nullptr;
+
+	if (AnimInstance != nullptr && UnequipAnimation != nullptr) {
+		if (UAnimMontage* Montage = AnimInstance->PlaySlotAnimationAsDynamicMontage(UnequipAnimation, TEXT("DefaultSlot"), WeaponSwapBlendTime, WeaponSwapBlendTime)) {
+			UnequipTime = FMath::Max(Montage->GetPlayLength() - WeaponSwapBlendTime, 0.0f);
+		}
+	}
+
+	WeaponSwapEndTime = FMath::Max(WeaponSwapEndTime, GetWorld()->GetTimeSeconds() + UnequipTime + WeaponSwapBlendTime);
+
+	if (UnequipTime > 0.0f) {
+		GetWorld()->GetTimerManager().SetTimer(SwapTimerHandle, FTimerDelegate::CreateUObject(this, &AMedievalFighterCharacter::FinishWeaponSwap, ToWeapon, bFirstPerson), UnequipTime, false);
+	}
+	else {
+		GetWorld()->GetTimerManager().ClearTimer(SwapTimerHandle);
+		FinishWeaponSwap(ToWeapon, bFirstPerson);
+	}
+}
+void AMedievalFighterCharacter::FinishWeaponSwap(EWeapons ToWeapon, bool bFirstPerson)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WeaponSwap);
+
+	if (ToWeapon != ActiveWeapon) {
+		return;
+	}
+
+	UAnimInstance* AnimInstance = (bFirstPerson ? GetMesh() : TPMesh)->GetAnimInstance();
+	ApplyWeaponMesh(bFirstPerson ? FPWeaponMesh : TPWeaponMesh, ToWeapon);
+
+	const FWeaponAssets* ToAssets = GetWeaponAssets(ToWeapon);
+	UAnimSequenceBase* EquipAnimation = ToAssets != nullptr ? ToAssets->EquipAnimation.Get() : nullptr;
+
+	if (AnimInstance != nullptr && EquipAnimation != nullptr) {
+		if (UAnimMontage* Montage = AnimInstance->PlaySlotAnimationAsDynamicMontage(EquipAnimation, TEXT("DefaultSlot"), WeaponSwapBlendTime, WeaponSwapBlendTime)) {
+			WeaponSwapEndTime = FMath::Max(WeaponSwapEndTime, GetWorld()->GetTimeSeconds() + Montage->GetPlayLength() - WeaponSwapBlendTime);
+		}
+	}
+}
+void AMedievalFighterCharacter::ApplyWeaponMesh(UStaticMeshComponent* WeaponMesh, EWeapons Weapon)
+{
+	const FWeaponAssets* Assets = GetWeaponAssets(Weapon);
+	UStaticMesh* WeaponStaticMesh = Assets != nullptr ? Assets->Mesh.LoadSynchronous() : nullptr;
+
+	switch (Weapon) {
 		case EWeapons::W_Dagger:
 		{
-			TPWeaponMesh->SetRelativeLocation(FVector(-8.781104f, 4.826352f, 0.126374f));
-			TPWeaponMesh->SetRelativeRotation(FRotator(4.980621f, 81.317833f, 119.621643f));
-			TPWeaponMesh->SetStaticMesh(DaggerAsset);
-			TPWeaponMesh->SetVisibility(true, false);
+			WeaponMesh->SetRelativeLocation(FVector(-8.781104f, 4.826352f, 0.126374f));
+			WeaponMesh->SetRelativeRotation(FRotator(4.980621f, 81.317833f, 119.621643f));
 		}
 			break;
 		case EWeapons::W_Halberd:
 		{
-			TPWeaponMesh->SetRelativeLocation(FVector(12.110796f, 5.220458f, -28.740444f));
-			TPWeaponMesh->SetRelativeRotation(FRotator(-9.99996f, -97.999985f, -124.999985f));
-			TPWeaponMesh->SetStaticMesh(HalberdAsset);
-			TPWeaponMesh->SetVisibility(true, false);
+			WeaponMesh->SetRelativeLocation(FVector(12.110796f, 5.220458f, -28.740444f));
+			WeaponMesh->SetRelativeRotation(FRotator(-9.99996f, -97.999985f, -124.999985f));
 		}
 			break;
 		case EWeapons::W_Longsword:
 		{
-			TPWeaponMesh->SetRelativeLocation(FVector(-8.573628f, 5.381995f, 0.508609f));
-			TPWeaponMesh->SetRelativeRotation(FRotator(0.000067f, 75.0f, -47.0f));
-			TPWeaponMesh->SetStaticMesh(LongSwordAsset);
-			TPWeaponMesh->SetVisibility(true, false);
+			WeaponMesh->SetRelativeLocation(FVector(-8.573628f, 5.381995f, 0.508609f));
+			WeaponMesh->SetRelativeRotation(FRotator(0.000067f, 75.0f, -47.0f));
 		}
 			break;
 		case EWeapons::W_Spear:
 		{
-			TPWeaponMesh->SetRelativeLocation(FVector(-12.062593f, 5.173286f, 1.960684f));
-			TPWeaponMesh->SetRelativeRotation(FRotator(2.0f, 82.0f, -43.0f));
-			TPWeaponMesh->SetStaticMesh(SpearAsset);
-			TPWeaponMesh->SetVisibility(true, false);
+			WeaponMesh->SetRelativeLocation(FVector(-12.062593f, 5.173286f, 1.960684f));
+			WeaponMesh->SetRelativeRotation(FRotator(2.0f, 82.0f, -43.0f));
+		}
+			break;
+		case EWeapons::W_Sword_and_Shield:
+		{
+			// One handed like the longsword, held with the same grip
+			WeaponMesh->SetRelativeLocation(FVector(-8.573628f, 5.381995f, 0.508609f));
+			WeaponMesh->SetRelativeRotation(FRotator(0.000067f, 75.0f, -47.0f));
 		}
 			break;
 		default:
-			TPWeaponMesh->SetRelativeLocation(FVector(0.0f, 0.0f, 0.0f));
-			TPWeaponMesh->SetRelativeRotation(FRotator(0.0f, 0.0f, 0.0f));
-			TPWeaponMesh->SetStaticMesh(NULL);
-			TPWeaponMesh->SetVisibility(false, false);
+			WeaponMesh->SetRelativeLocation(FVector(0.0f, 0.0f, 0.0f));
+			WeaponMesh->SetRelativeRotation(FRotator(0.0f, 0.0f, 0.0f));
+	}
+
+	WeaponMesh->SetStaticMesh(WeaponStaticMesh);
+	WeaponMesh->SetVisibility(WeaponStaticMesh != nullptr, false);
+}
+const FWeaponAssets* AMedievalFighterCharacter::GetWeaponAssets(EWeapons Weapon) const
+{
+	switch (Weapon) {
+		case EWeapons::W_Dagger:
+			return &DaggerAssets;
+		case EWeapons::W_Halberd:
+			return &HalberdAssets;
+		case EWeapons::W_Longsword:
+			return &LongSwordAssets;
+		case EWeapons::W_Spear:
+			return &SpearAssets;
+		case EWeapons::W_Sword_and_Shield:
+			return &SwordAndShieldAssets;
+		default:
+			return nullptr;
+	}
+}
+bool AMedievalFighterCharacter::IsSwinging() const
+{
+	if (bAttacking) {
+		return true;
 	}
+
+	UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance();
+
+	return FPAttackMontage != nullptr && AnimInstance != nullptr && AnimInstance->Montage_IsPlaying(FPAttackMontage);
+}
+bool AMedievalFighterCharacter::IsSwappingWeapon() const
+{
+	if (FPWeaponLoadHandle.IsValid() && FPWeaponLoadHandle->IsLoadingInProgress()) {
+		return true;
+	}
+	if (TPWeaponLoadHandle.IsValid() && TPWeaponLoadHandle->IsLoadingInProgress()) {
+		return true;
+	}
+
+	return GetWorld()->GetTimeSeconds() < WeaponSwapEndTime;
 }
 //////////////////////////////////////////////////////////////////////////
 // Attack
 //////////////////////////////////////////////////////////////////////////
 void AMedievalFighterCharacter::Attack()
 {
-	if (!bAttacking) {
+	if (!bAttacking && !IsSwappingWeapon() && !IsDead()) {
 		AttackServer();
 
-		switch (ActiveWeapon) {
-			case EWeapons::W_Dagger:
-			{
-				GetMesh()->GetAnimInstance()->Montage_Play(DaggerAttackMontage);
-			}
-				break;
-			case EWeapons::W_Halberd:
-			{
-				GetMesh()->GetAnimInstance()->Montage_Play(HalberdAttackMontage);
-			}
-				break;
-			case EWeapons::W_Longsword:
-			{
-				GetMesh()->GetAnimInstance()->Montage_Play(LongSwordAttackMontage);
-			}
-				break;
-			case EWeapons::W_Spear:
-			{
-				GetMesh()->GetAnimInstance()->Montage_Play(SpearAttackMontage);
-			}
-				break;
+		const FWeaponAssets* Assets = GetWeaponAssets(ActiveWeapon);
+		UAnimSequenceBase* AttackAnimation = Assets != nullptr ? Assets->AttackAnimation.LoadSynchronous() : nullptr;
+		FPAttackMontage = PlayWeaponAnimation(GetMesh(), AttackAnimation);
+
+		if (FPAttackMontage != nullptr && !AttackAnimation->IsA<UAnimMontage>()) {
+			FOnMontageEnded EndDelegate = FOnMontageEnded::CreateUObject(this, &AMedievalFighterCharacter::OnFPAttackMontageEnded);
+			GetMesh()->GetAnimInstance()->Montage_SetEndDelegate(EndDelegate, FPAttackMontage);
 		}
 	}
 }
+UAnimMontage* AMedievalFighterCharacter::PlayWeaponAnimation(USkeletalMeshComponent* SkeletalMesh, UAnimSequenceBase* Animation)
+{
+	UAnimInstance* AnimInstance = SkeletalMesh->GetAnimInstance();
+	if (AnimInstance == nullptr || Animation == nullptr) {
+		return nullptr;
+	}
+
+	if (UAnimMontage* Montage = Cast<UAnimMontage>(Animation)) {
+		return AnimInstance->Montage_Play(Montage) > 0.0f ? Montage : nullptr;
+	}
+
+	return AnimInstance->PlaySlotAnimationAsDynamicMontage(Animation, TEXT("DefaultSlot"));
+}
+void AMedievalFighterCharacter::OnFPAttackMontageEnded(UAnimMontage* Montage, bool bInterrupted)
+{
+	if (Montage == FPAttackMontage && bAttacking) {
+		AttackResetServer();
+	}
+}
 void AMedievalFighterCharacter::AttackServer_Implementation() 
 {
 	AttackMulticast();
@@ -328,31 +456,11 @@ bool AMedievalFighterCharacter::AttackServer_Validate()
 }
 void AMedievalFighterCharacter::AttackMulticast_Implementation() 
 {
-	TPWeaponMesh->SetCollisionProfileName(TEXT("OverlapAll"));
 	bAttacking = true;
+	SwingHitPlayers.Reset();
 
-	switch (ActiveWeapon) {
-		case EWeapons::W_Dagger:
-		{
-			TPMesh->GetAnimInstance()->Montage_Play(DaggerAttackMontage);
-		}
-			break;
-		case EWeapons::W_Halberd:
-		{
-			TPMesh->GetAnimInstance()->Montage_Play(HalberdAttackMontage);
-		}
-			break;
-		case EWeapons::W_Longsword:
-		{
-			TPMesh->GetAnimInstance()->Montage_Play(LongSwordAttackMontage);
-		}
-			break;
-		case EWeapons::W_Spear:
-		{
-			TPMesh->GetAnimInstance()->Montage_Play(SpearAttackMontage);
-		}
-			break;
-	}
+	const FWeaponAssets* Assets = GetWeaponAssets(ActiveWeapon);
+	PlayWeaponAnimation(TPMesh, Assets != nullptr ? Assets->AttackAnimation.LoadSynchronous() : nullptr);
 }
 void AMedievalFighterCharacter::AttackResetServer_Implementation()
 {
@@ -372,19 +480,50 @@ bool AMedievalFighterCharacter::AttackResetServer_Validate()
 void AMedievalFighterCharacter::AttackResetMulticast_Implementation()
 {
 	bAttacking = false;
-	TPWeaponMesh->SetCollisionProfileName(TEXT("NoCollision"));
+	SwingHitPlayers.Reset();
 	HitPlayersArray.Empty();
 }
 //////////////////////////////////////////////////////////////////////////
 // Damage System
 //////////////////////////////////////////////////////////////////////////
-void AMedievalFighterCharacter::WeaponMeshOverlap(class UPrimitiveComponent* OverlappedComp, class AActor* OtherActor, class UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+void AMedievalFighterCharacter::QueryWeaponHits()
 {
-	AMedievalFighterCharacter* HitPlayer = Cast<AMedievalFighterCharacter>(OtherActor);
+	const int32 FirstNewHit = SwingHitPlayers.Num();
+	GetWeaponHits(SwingHitPlayers);
 
-	if (HitPlayer != nullptr) {
-		if (OtherActor != this) {
-			HitPlayerServer(HitPlayer);
+	for (int32 Index = FirstNewHit; Index < SwingHitPlayers.Num(); Index++) {
+		HitPlayerServer(SwingHitPlayers[Index]);
+	}
+}
+void AMedievalFighterCharacter::GetWeaponHits(TArray<AMedievalFighterCharacter*>& OutHits)
+{
+	SCOPE_CYCLE_COUNTER(STAT_SwingQuery);
+
+	if (TPWeaponMesh->GetStaticMesh() == nullptr) {
+		return;
+	}
+
+	// Broadphase: only fighters near the blade
+	const FBox WeaponBox = TPWeaponMesh->Bounds.GetBox();
+	SwingCandidates.Reset();
+	FCombatBroadphase::Get(GetWorld()).QueryBox(WeaponBox, SwingCandidates);
+
+	// Narrowphase: blade against the candidate's bodies, without touching the physics scene
+	const FVector WeaponLocation = TPWeaponMesh->GetComponentLocation();
+	const FQuat WeaponRotation = TPWeaponMesh->GetComponentQuat();
+
+	for (AMedievalFighterCharacter* Candidate : SwingCandidates) {
+		if (Candidate == this || Candidate->IsDead() || SwingHitPlayers.Contains(Candidate)) {
+			continue;
+		}
+
+		USkeletalMeshComponent* CandidateMesh = Candidate->GetTPMesh();
+		if (!CandidateMesh->Bounds.GetBox().Intersect(WeaponBox)) {
+			continue;
+		}
+
+		if (CandidateMesh->ComponentOverlapComponent(TPWeaponMesh, WeaponLocation, WeaponRotation, FCollisionQueryParams::DefaultQueryParam)) {
+			OutHits.Add(Candidate);
 		}
 	}
 }
@@ -412,46 +551,82 @@ void AMedievalFighterCharacter::HitPlayerMulticast_Implementation(AMedievalFight
 			}
 			else if (Index >= HitPlayersArray.Num()) {
 				HitPlayersArray.Add(PlayerHit);
-				PlayerHit->TakeDamage(25.0f);
+				PlayerHit->TakeDamage(25.0f, this);
 			}
 		}
 	}
 	else {
 		HitPlayersArray.Add(PlayerHit);
-		PlayerHit->TakeDamage(25.0f);
+		PlayerHit->TakeDamage(25.0f, this);
 	}
 }
-void AMedievalFighterCharacter::TakeDamage(float Damage)
+void AMedievalFighterCharacter::TakeDamage(float Damage, AMedievalFighterCharacter* DamageCauser)
 {
-	Health -= Damage;
+	if (IsDead()) {
+		return;
+	}
 
-	switch (ActiveWeapon) {
-		case EWeapons::W_Dagger:
-		{
-			GetMesh()->GetAnimInstance()->Montage_Play(DaggerDamageMontage);
-			TPMesh->GetAnimInstance()->Montage_Play(DaggerDamageMontage);
-		}
-			break;
-		case EWeapons::W_Halberd:
-		{
-			GetMesh()->GetAnimInstance()->Montage_Play(HalberdDamageMontage);
-			TPMesh->GetAnimInstance()->Montage_Play(HalberdDamageMontage);
-		}
-			break;
-		case EWeapons::W_Longsword:
-		{
-			GetMesh()->GetAnimInstance()->Montage_Play(LongSwordDamageMontage);
-			TPMesh->GetAnimInstance()->Montage_Play(LongSwordDamageMontage);
+	Health = FMath::Max(Health - Damage, 0.0f);
+
+	if (IsDead()) {
+		Die(DamageCauser);
+		return;
+	}
+
+	const FWeaponAssets* Assets = GetWeaponAssets(ActiveWeapon);
+	UAnimSequenceBase* DamageAnimation = Assets != nullptr ? Assets->DamageAnimation.LoadSynchronous() : nullptr;
+	PlayWeaponAnimation(GetMesh(), DamageAnimation);
+	PlayWeaponAnimation(TPMesh, DamageAnimation);
+}
+void AMedievalFighterCharacter::Die(AMedievalFighterCharacter* Killer)
+{
+	// Stop taking part in combat, swings skip dead fighters
+	bAttacking = false;
+	GetCharacterMovement()->DisableMovement();
+
+	if (HasAuthority()) {
+		if (AMedievalFighterGameMode* GameMode = GetWorld()->GetAuthGameMode<AMedievalFighterGameMode>()) {
+			GameMode->FighterKilled(this, Killer);
 		}
-			break;
-		case EWeapons::W_Spear:
-		{
-			GetMesh()->GetAnimInstance()->Montage_Play(SpearDamageMontage);
-			TPMesh->GetAnimInstance()->Montage_Play(SpearDamageMontage);
+		else {
+			// Levels overriding the game mode have no rounds, respawn after the same delay
+			GetWorldTimerManager().SetTimer(RespawnTimerHandle, this, &AMedievalFighterCharacter::ReviveAtPlayerStart, GetDefault<AMedievalFighterGameMode>()->RespawnDelay, false);
 		}
-			break;
 	}
 }
+void AMedievalFighterCharacter::ReviveAtPlayerStart()
+{
+	AGameModeBase* GameMode = GetWorld()->GetAuthGameMode();
+	AActor* StartSpot = GameMode != nullptr && GetController() != nullptr ? GameMode->ChoosePlayerStart(GetController()) : nullptr;
+
+	Revive(StartSpot != nullptr ? StartSpot->GetActorTransform() : GetActorTransform());
+}
+void AMedievalFighterCharacter::Revive(const FTransform& SpawnTransform)
+{
+	if (!HasAuthority()) {
+		return;
+	}
+
+	const FRotator SpawnRotation = SpawnTransform.Rotator();
+	TeleportTo(SpawnTransform.GetLocation(), SpawnRotation);
+	if (AController* FighterController = GetController()) {
+		FighterController->ClientSetRotation(SpawnRotation);
+	}
+
+	ReviveMulticast();
+}
+void AMedievalFighterCharacter::ReviveMulticast_Implementation()
+{
+	GetWorldTimerManager().ClearTimer(RespawnTimerHandle);
+
+	Health = GetClass()->GetDefaultObject<AMedievalFighterCharacter>()->Health;
+	bAttacking = false;
+	SwingHitPlayers.Reset();
+	HitPlayersArray.Reset();
+
+	GetCharacterMovement()->StopMovementImmediately();
+	GetCharacterMovement()->SetMovementMode(MOVE_Walking);
+}
 //////////////////////////////////////////////////////////////////////////
 // Movement
 //////////////////////////////////////////////////////////////////////////
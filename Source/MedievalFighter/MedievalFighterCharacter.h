@@ -6,6 +6,11 @@
 #include "GameFramework/Character.h"
 #include "MedievalFighterCharacter.generated.h"
 
+class UStaticMesh;
+class UAnimMontage;
+class UAnimSequenceBase;
+struct FStreamableHandle;
+
 UENUM(BlueprintType)
 enum EWeapons
 {
@@ -17,6 +22,36 @@ enum EWeapons
 	W_Sword_and_Shield	UMETA(DisplayName = "Sword and Shield")
 };
 
+/** Assets a weapon needs, resolved lazily from the preload manifest in DefaultGame.ini */
+USTRUCT(BlueprintType)
+struct FWeaponAssets
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon")
+		TSoftObjectPtr<UStaticMesh> Mesh;
+	/** Montage, or a sequence played in the default slot that ends the swing when it finishes */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon")
+		TSoftObjectPtr<UAnimSequenceBase> AttackAnimation;
+	/** Montage, or a sequence played in the default slot */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon")
+		TSoftObjectPtr<UAnimSequenceBase> DamageAnimation;
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon")
+		TSoftObjectPtr<UAnimSequenceBase> EquipAnimation;
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapon")
+		TSoftObjectPtr<UAnimSequenceBase> UnequipAnimation;
+
+	/** Adds every asset of the weapon to the list */
+	void GetAssetPaths(TArray<FSoftObjectPath>& OutPaths) const
+	{
+		OutPaths.Add(Mesh.ToSoftObjectPath());
+		OutPaths.Add(AttackAnimation.ToSoftObjectPath());
+		OutPaths.Add(DamageAnimation.ToSoftObjectPath());
+		OutPaths.Add(EquipAnimation.ToSoftObjectPath());
+		OutPaths.Add(UnequipAnimation.ToSoftObjectPath());
+	}
+};
+
 UCLASS(config=Game)
 class AMedievalFighterCharacter : public ACharacter
 {
@@ -36,7 +71,7 @@ class AMedievalFighterCharacter : public ACharacter
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Third Person", meta = (AllowPrivateAccess = "true"))
 		class UStaticMeshComponent* TPWeaponMesh;
 public:
-	AMedievalFighterCharacter();
+	AMedievalFighterCharacter(const FObjectInitializer& ObjectInitializer);
 
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere, Category = "Gameplay", meta = (AllowPrivateAccess = "true"))
 		TEnumAsByte<EWeapons> ActiveWeapon;
@@ -47,25 +82,23 @@ protected:
 	FTimerHandle JumpTimerHandle;
 	FTimerHandle InSprintTimerHandle;
 	FTimerHandle DeSprintTimerHandle;
+	FTimerHandle FPWeaponSwapTimerHandle;
+	FTimerHandle TPWeaponSwapTimerHandle;
+	FTimerHandle RespawnTimerHandle;
 
 	//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// Mesh
 	//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-	UStaticMesh* DaggerAsset;
-	UAnimMontage* DaggerAttackMontage;
-	UAnimMontage* DaggerDamageMontage;
-
-	UStaticMesh* HalberdAsset;
-	UAnimMontage* HalberdAttackMontage;
-	UAnimMontage* HalberdDamageMontage;
-
-	UStaticMesh* LongSwordAsset;
-	UAnimMontage* LongSwordAttackMontage;
-	UAnimMontage* LongSwordDamageMontage;
-
-	UStaticMesh* SpearAsset;
-	UAnimMontage* SpearAttackMontage;
-	UAnimMontage* SpearDamageMontage;
+	UPROPERTY(config, EditDefaultsOnly, Category = "Weapons")
+		FWeaponAssets DaggerAssets;
+	UPROPERTY(config, EditDefaultsOnly, Category = "Weapons")
+		FWeaponAssets HalberdAssets;
+	UPROPERTY(config, EditDefaultsOnly, Category = "Weapons")
+		FWeaponAssets LongSwordAssets;
+	UPROPERTY(config, EditDefaultsOnly, Category = "Weapons")
+		FWeaponAssets SpearAssets;
+	UPROPERTY(config, EditDefaultsOnly, Category = "Weapons")
+		FWeaponAssets SwordAndShieldAssets;
 
 	//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// NOT REPLICATED VARIABLES
@@ -76,6 +109,25 @@ protected:
 	UPROPERTY(BlueprintReadOnly, Category = "Movement")
 		float SpeedDecrease;
 
+	/** Blend time of equip and unequip animations */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Weapons")
+		float WeaponSwapBlendTime;
+
+	/** First person attack last played, a dynamic montage for weapons whose attack is a plain sequence */
+	UPROPERTY(Transient)
+		class UAnimMontage* FPAttackMontage;
+
+	/** World time at which the current weapon swap finishes */
+	float WeaponSwapEndTime;
+	/** Weapon assets streaming in for the first and third person swaps */
+	TSharedPtr<FStreamableHandle> FPWeaponLoadHandle;
+	TSharedPtr<FStreamableHandle> TPWeaponLoadHandle;
+
+	/** Players already reported to the server during the current swing */
+	TArray<AMedievalFighterCharacter*> SwingHitPlayers;
+	/** Broadphase results of the last swing query, kept to avoid allocating every tick */
+	TArray<AMedievalFighterCharacter*> SwingCandidates;
+
 	//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// REPLICATED VARIABLES
 	//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -110,17 +162,29 @@ protected:
 	/** Called to set weapon */
 	UFUNCTION(BlueprintCallable, Category = "Multiplayer Gameplay")
 		void SetWeapon(EWeapons WeaponToSet);
+	/** Loads a weapon's assets if needed, then swaps to it on the first or third person meshes */
+	void RequestWeaponSwap(EWeapons FromWeapon, EWeapons ToWeapon, bool bFirstPerson);
+	/** Plays the unequip animation of the old weapon and schedules the equip */
+	void StartWeaponSwap(EWeapons FromWeapon, EWeapons ToWeapon, bool bFirstPerson);
+	/** Puts the new weapon in hand and plays its equip animation */
+	void FinishWeaponSwap(EWeapons ToWeapon, bool bFirstPerson);
+	/** Positions a weapon mesh for the given weapon */
+	void ApplyWeaponMesh(UStaticMeshComponent* WeaponMesh, EWeapons Weapon);
 
 	/** Called To Attack */
 	UFUNCTION(BlueprintCallable, Category = "Multiplayer Gameplay")
 		void Attack();
-	/** Called when weapon mesh is overlapped */
-	UFUNCTION(Category = "Combat")
-		void WeaponMeshOverlap(class UPrimitiveComponent* OverlappedComp, class AActor* OtherActor, class UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
+	/** Plays a weapon animation on a mesh, montages as they are and sequences in the default slot */
+	UAnimMontage* PlayWeaponAnimation(USkeletalMeshComponent* SkeletalMesh, UAnimSequenceBase* Animation);
+	/** Ends the swing of an attack played from a sequence, which has no reset notify of its own */
+	void OnFPAttackMontageEnded(UAnimMontage* Montage, bool bInterrupted);
+	/** Called every tick of a swing to report players touched by the weapon mesh */
+	void QueryWeaponHits();
 
-	/** Takes damage */
-	UFUNCTION(BlueprintCallable, Category = "Combat")
-		void TakeDamage(float Damage);
+	/** Called once when health runs out */
+	void Die(AMedievalFighterCharacter* Killer);
+	/** Revives at a player start picked by the generic game mode, for levels without rounds */
+	void ReviveAtPlayerStart();
 
 	//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// Network
@@ -163,6 +227,11 @@ protected:
 		void SetWeaponMulticast(EWeapons WeaponToSet);
 		void SetWeaponMulticast_Implementation(EWeapons WeaponToSet);
 
+	/** Revive (Multicast) */
+	UFUNCTION(NetMulticast, Reliable, Category = "Multiplayer Combat")
+		void ReviveMulticast();
+		void ReviveMulticast_Implementation();
+
 	/** Set sprinting bool (Server) */
 	UFUNCTION(Server, Reliable, WithValidation, Category = "Multiplayer Movement Functions")
 		void SetbSprinting(bool ToSet);
@@ -191,11 +260,40 @@ protected:
 		void DecreaseSpeedM(float CurrentSpeed);
 		void DecreaseSpeedM_Implementation(float CurrentSpeed);
 protected:
+	// AActor interface
+	virtual void BeginPlay() override;
+	virtual void PostInitializeComponents() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Tick(float DeltaSeconds) override;
+	// End of AActor interface
+
 	// APawn interface
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 	// End of APawn interface
 
 public:
+	/** Returns true while an attack is running, from local animation state rather than replication */
+	bool IsSwinging() const;
+	/** Returns true while a weapon swap is loading or running */
+	bool IsSwappingWeapon() const;
+
+	/** Returns true once health has run out */
+	FORCEINLINE bool IsDead() const { return Health <= 0.0f; }
+
+	/** Takes damage */
+	UFUNCTION(BlueprintCallable, Category = "Combat")
+		void TakeDamage(float Damage, AMedievalFighterCharacter* DamageCauser = nullptr);
+	/** Restores health and movement and moves the fighter, called on the server instead of respawning a new pawn */
+	void Revive(const FTransform& SpawnTransform);
+
+	/** Adds fighters the third person weapon touches that haven't been hit this swing yet */
+	void GetWeaponHits(TArray<AMedievalFighterCharacter*>& OutHits);
+	/** Returns the assets of a weapon, or null for no weapon */
+	const FWeaponAssets* GetWeaponAssets(EWeapons Weapon) const;
+
+	/** Returns every asset the character can need, for preloading during map load */
+	void GetPreloadAssetPaths(TArray<FSoftObjectPath>& OutPaths) const;
+
 	/** Returns first person camera subobject **/
 	FORCEINLINE class UCameraComponent* GetFPCamera() const { return FPCamera; }
 	/** Returns first person weapon mesh subobject **/
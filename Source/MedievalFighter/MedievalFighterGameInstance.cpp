@@ -0,0 +1,221 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "MedievalFighterGameInstance.h"
+#include "MedievalFighterCharacter.h"
+#include "MedievalFighterGameMode.h"
+#include "MedievalFighterMovementComponent.h"
+#include "MedievalFighter.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/AssetManager.h"
+#include "Engine/Engine.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StreamableManager.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerStart.h"
+#include "TimerManager.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMedievalFighterBenchmark, Log, All);
+
+void UMedievalFighterGameInstance::Init()
+{
+	Super::Init();
+
+	// Stream the character's assets while the first map loads instead of resolving them on the game thread.
+	// Read from FighterClass, which the game mode loads during InitGame anyway, so Blueprint overrides are included
+	TArray<FSoftObjectPath> AssetPaths;
+	AMedievalFighterGameMode::GetFighterDefaults()->GetPreloadAssetPaths(AssetPaths);
+	AssetPaths.RemoveAll([](const FSoftObjectPath& Path) { return Path.IsNull(); });
+
+	if (AssetPaths.Num() > 0) {
+		PreloadHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(AssetPaths, FStreamableDelegate(), FStreamableManager::AsyncLoadHighPriority);
+	}
+}
+void UMedievalFighterGameInstance::Shutdown()
+{
+	if (PreloadHandle.IsValid()) {
+		PreloadHandle->ReleaseHandle();
+		PreloadHandle.Reset();
+	}
+
+	Super::Shutdown();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Benchmarks
+//////////////////////////////////////////////////////////////////////////
+void UMedievalFighterGameInstance::BenchmarkCombatQueries(int32 Iterations)
+{
+	UWorld* World = GetWorld();
+	AGameModeBase* GameMode = World != nullptr ? World->GetAuthGameMode() : nullptr;
+	if (GameMode == nullptr) {
+		UE_LOG(LogMedievalFighterBenchmark, Warning, TEXT("BenchmarkCombatQueries has to run on the server"));
+		return;
+	}
+
+	Iterations = FMath::Max(Iterations, 1);
+
+	TSubclassOf<AMedievalFighterCharacter> FighterClass = AMedievalFighterCharacter::StaticClass();
+	if (GameMode->DefaultPawnClass != nullptr && GameMode->DefaultPawnClass->IsChildOf(AMedievalFighterCharacter::StaticClass())) {
+		FighterClass = *GameMode->DefaultPawnClass;
+	}
+
+	// Fight where players spawn so the physics path sees the level's real geometry
+	FVector Origin = FVector::ZeroVector;
+	for (TActorIterator<APlayerStart> It(World); It; ++It) {
+		Origin = It->GetActorLocation();
+		break;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	// Everyone holds the longest blade so swings reach their neighbours
+	const FWeaponAssets* WeaponAssets = AMedievalFighterGameMode::GetFighterDefaults()->GetWeaponAssets(EWeapons::W_Spear);
+	UStaticMesh* WeaponStaticMesh = WeaponAssets != nullptr ? WeaponAssets->Mesh.LoadSynchronous() : nullptr;
+	if (WeaponStaticMesh == nullptr) {
+		UE_LOG(LogMedievalFighterBenchmark, Warning, TEXT("BenchmarkCombatQueries needs the spear mesh"));
+		return;
+	}
+
+	const FCollisionObjectQueryParams AllObjects(FCollisionObjectQueryParams::AllObjects);
+	const FCollisionObjectQueryParams HitboxObjects(ECC_Hitbox);
+	const int32 FighterCounts[] = { 16, 64, 256 };
+
+	TArray<AMedievalFighterCharacter*> Fighters;
+	TArray<AMedievalFighterCharacter*> Hits;
+	TArray<FOverlapResult> Overlaps;
+
+	for (int32 FighterCount : FighterCounts) {
+		// Melee spacing on a square grid
+		const int32 Side = FMath::CeilToInt(FMath::Sqrt(float(FighterCount)));
+		const float Spacing = 150.0f;
+
+		Fighters.Reset();
+		for (int32 Index = 0; Index < FighterCount; Index++) {
+			const FVector Location = Origin + FVector((Index % Side) * Spacing, (Index / Side) * Spacing, 0.0f);
+			if (AMedievalFighterCharacter* Fighter = World->SpawnActor<AMedievalFighterCharacter>(FighterClass, Location, FRotator::ZeroRotator, SpawnParams)) {
+				Fighter->GetTPWeaponMesh()->SetStaticMesh(WeaponStaticMesh);
+				Fighters.Add(Fighter);
+			}
+		}
+
+		if (Fighters.Num() == 0) {
+			continue;
+		}
+
+		int64 SwingResults = 0;
+
+		// The real swing query: broadphase, bounds filter and the blade against each candidate's bodies
+		double StartTime = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < Iterations; Iteration++) {
+			Hits.Reset();
+			Fighters[Iteration % Fighters.Num()]->GetWeaponHits(Hits);
+			SwingResults += Hits.Num();
+		}
+		const double SwingTime = FPlatformTime::Seconds() - StartTime;
+
+		// The same blade through the physics scene, then reduced to distinct fighters as a swing would need
+		auto PhysicsSwing = [&](const FCollisionObjectQueryParams& ObjectParams) -> int64
+		{
+			int64 FighterHits = 0;
+			for (int32 Iteration = 0; Iteration < Iterations; Iteration++) {
+				const AMedievalFighterCharacter* Attacker = Fighters[Iteration % Fighters.Num()];
+				const UStaticMeshComponent* Weapon = Attacker->GetTPWeaponMesh();
+
+				Overlaps.Reset();
+				Hits.Reset();
+				World->ComponentOverlapMulti(Overlaps, Weapon, Weapon->GetComponentLocation(), Weapon->GetComponentQuat(), FComponentQueryParams::DefaultComponentQueryParams, ObjectParams);
+				for (const FOverlapResult& Overlap : Overlaps) {
+					AMedievalFighterCharacter* Fighter = Cast<AMedievalFighterCharacter>(Overlap.GetActor());
+					if (Fighter != nullptr && Fighter != Attacker) {
+						Hits.AddUnique(Fighter);
+					}
+				}
+				FighterHits += Hits.Num();
+			}
+			return FighterHits;
+		};
+
+		StartTime = FPlatformTime::Seconds();
+		const int64 AllObjectsResults = PhysicsSwing(AllObjects);
+		const double AllObjectsTime = FPlatformTime::Seconds() - StartTime;
+
+		StartTime = FPlatformTime::Seconds();
+		const int64 HitboxResults = PhysicsSwing(HitboxObjects);
+		const double HitboxTime = FPlatformTime::Seconds() - StartTime;
+
+		UE_LOG(LogMedievalFighterBenchmark, Log, TEXT("%d fighters, %d swings: broadphase + narrowphase %.3f us (%.2f hits), physics all objects %.3f us (%.2f hits), physics hitbox channel %.3f us (%.2f hits)"),
+			Fighters.Num(), Iterations,
+			SwingTime * 1000000.0 / Iterations, double(SwingResults) / Iterations,
+			AllObjectsTime * 1000000.0 / Iterations, double(AllObjectsResults) / Iterations,
+			HitboxTime * 1000000.0 / Iterations, double(HitboxResults) / Iterations);
+
+		for (AMedievalFighterCharacter* Fighter : Fighters) {
+			Fighter->Destroy();
+		}
+	}
+}
+void UMedievalFighterGameInstance::BenchmarkMovement(int32 Seconds, int32 PktLag)
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr || World->GetNetDriver() == nullptr) {
+		UE_LOG(LogMedievalFighterBenchmark, Warning, TEXT("BenchmarkMovement needs a networked game"));
+		return;
+	}
+
+	// Packet simulation is compiled out of shipping builds, the lag is then simply not applied
+	GEngine->Exec(World, *FString::Printf(TEXT("Net PktLag=%d"), PktLag));
+
+	MovementBenchmarkSeconds = FMath::Max(Seconds, 1);
+	MovementBenchmarkSecondsLeft = MovementBenchmarkSeconds;
+	MovementBenchmarkPktLag = PktLag;
+	MovementBenchmarkUpstreamBytes = 0;
+	MovementBenchmarkStartMoveSeconds = UMedievalFighterMovementComponent::TotalServerMoveSeconds;
+	MovementBenchmarkStartMoves = UMedievalFighterMovementComponent::TotalServerMoves;
+
+	GetTimerManager().SetTimer(MovementBenchmarkTimerHandle, this, &UMedievalFighterGameInstance::SampleMovementBenchmark, 1.0f, true);
+}
+void UMedievalFighterGameInstance::SampleMovementBenchmark()
+{
+	UWorld* World = GetWorld();
+	UNetDriver* NetDriver = World != nullptr ? World->GetNetDriver() : nullptr;
+	if (NetDriver == nullptr) {
+		GetTimerManager().ClearTimer(MovementBenchmarkTimerHandle);
+		return;
+	}
+
+	// Connections recompute their byte rates once a second, so one sample per second covers all traffic
+	int32 Connections = 0;
+	if (NetDriver->ServerConnection != nullptr) {
+		MovementBenchmarkUpstreamBytes += NetDriver->ServerConnection->OutBytesPerSecond;
+		Connections = 1;
+	}
+	else {
+		for (UNetConnection* Connection : NetDriver->ClientConnections) {
+			MovementBenchmarkUpstreamBytes += Connection->InBytesPerSecond;
+		}
+		Connections = NetDriver->ClientConnections.Num();
+	}
+
+	if (--MovementBenchmarkSecondsLeft > 0) {
+		return;
+	}
+
+	GetTimerManager().ClearTimer(MovementBenchmarkTimerHandle);
+	GEngine->Exec(World, TEXT("Net PktLag=0"));
+
+	const double MoveSeconds = UMedievalFighterMovementComponent::TotalServerMoveSeconds - MovementBenchmarkStartMoveSeconds;
+	const int64 Moves = UMedievalFighterMovementComponent::TotalServerMoves - MovementBenchmarkStartMoves;
+
+	UE_LOG(LogMedievalFighterBenchmark, Log, TEXT("PktLag %d ms over %d s, %d connections: upstream %.1f bytes/s per connection, %.1f server moves/s, %.3f us per server move, %.3f ms server move time per second"),
+		MovementBenchmarkPktLag, MovementBenchmarkSeconds, Connections,
+		Connections > 0 ? double(MovementBenchmarkUpstreamBytes) / (MovementBenchmarkSeconds * Connections) : 0.0,
+		double(Moves) / MovementBenchmarkSeconds,
+		Moves > 0 ? MoveSeconds * 1000000.0 / Moves : 0.0,
+		MoveSeconds * 1000.0 / MovementBenchmarkSeconds);
+}
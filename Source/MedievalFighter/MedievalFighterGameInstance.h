@@ -0,0 +1,46 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/GameInstance.h"
+#include "MedievalFighterGameInstance.generated.h"
+
+struct FStreamableHandle;
+
+UCLASS()
+class UMedievalFighterGameInstance : public UGameInstance
+{
+	GENERATED_BODY()
+
+public:
+	// UGameInstance interface
+	virtual void Init() override;
+	virtual void Shutdown() override;
+	// End of UGameInstance interface
+
+	/** Times swing target queries through the combat broadphase against physics overlaps with 16, 64 and 256 fighters */
+	UFUNCTION(Exec, Category = "Benchmark")
+		void BenchmarkCombatQueries(int32 Iterations);
+	/** Emulates the given packet lag for a number of seconds, then logs upstream bytes and server time spent on client moves */
+	UFUNCTION(Exec, Category = "Benchmark")
+		void BenchmarkMovement(int32 Seconds, int32 PktLag);
+
+protected:
+	/** Keeps the character's preload manifest resident for the lifetime of the game */
+	TSharedPtr<FStreamableHandle> PreloadHandle;
+
+	//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Movement benchmark
+	//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	FTimerHandle MovementBenchmarkTimerHandle;
+	int32 MovementBenchmarkSeconds;
+	int32 MovementBenchmarkSecondsLeft;
+	int32 MovementBenchmarkPktLag;
+	int64 MovementBenchmarkUpstreamBytes;
+	double MovementBenchmarkStartMoveSeconds;
+	int64 MovementBenchmarkStartMoves;
+
+	/** Adds up one second of upstream traffic, and logs the results once the benchmark is over */
+	void SampleMovementBenchmark();
+};
@@ -0,0 +1,346 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "MedievalFighterGameMode.h"
+#include "MedievalFighterBotController.h"
+#include "MedievalFighterCharacter.h"
+#include "MedievalFighterGameState.h"
+#include "MedievalFighterPlayerState.h"
+#include "CombatBroadphase.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/Controller.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+#include "TimerManager.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMedievalFighterGameMode, Log, All);
+
+AMedievalFighterGameMode::AMedievalFighterGameMode()
+{
+	GameStateClass = AMedievalFighterGameState::StaticClass();
+	PlayerStateClass = AMedievalFighterPlayerState::StaticClass();
+
+	RoundTime = 180;
+	ScoreLimit = 10;
+	RespawnDelay = 3.0f;
+	RoundEndDelay = 5.0f;
+
+	SoakRoundTime = 5;
+	SoakSampleRounds = 50;
+	SoakMaxGrowthMB = 16;
+	SoakRoundCount = 0;
+	SoakRoundsPlayed = 0;
+	SoakBaselineMemory = 0;
+	SoakLastMemory = 0;
+	bExitAfterSoak = false;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Game Mode
+//////////////////////////////////////////////////////////////////////////
+void AMedievalFighterGameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	if (!FighterClass.IsNull()) {
+		DefaultPawnClass = FighterClass.LoadSynchronous();
+	}
+
+	// Enough for a full server, so rounds never grow these
+	PendingRespawns.Reserve(64);
+}
+void AMedievalFighterGameMode::StartPlay()
+{
+	Super::StartPlay();
+
+	StartRound();
+
+	int32 Rounds = 0;
+	if (FParse::Value(FCommandLine::Get(), TEXT("SoakRounds="), Rounds) && Rounds > 0) {
+		bExitAfterSoak = true;
+		SoakRounds(Rounds);
+	}
+}
+const AMedievalFighterCharacter* AMedievalFighterGameMode::GetFighterDefaults()
+{
+	// Blueprint fighters override the weapon assets, so their defaults hold the real manifest
+	UClass* Class = GetDefault<AMedievalFighterGameMode>()->FighterClass.LoadSynchronous();
+	if (Class != nullptr && Class->IsChildOf(AMedievalFighterCharacter::StaticClass())) {
+		return Class->GetDefaultObject<AMedievalFighterCharacter>();
+	}
+
+	return GetDefault<AMedievalFighterCharacter>();
+}
+AMedievalFighterGameState* AMedievalFighterGameMode::GetFighterGameState() const
+{
+	return GetGameState<AMedievalFighterGameState>();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Round Flow
+//////////////////////////////////////////////////////////////////////////
+void AMedievalFighterGameMode::StartRound()
+{
+	AMedievalFighterGameState* FighterGameState = GetFighterGameState();
+	if (FighterGameState == nullptr) {
+		return;
+	}
+
+	// Soak memory is sampled here, after the garbage collection requested when the last round ended
+	if (SoakRoundCount > 0) {
+		if (SoakRoundsPlayed % FMath::Max(SoakSampleRounds, 1) == 0 || SoakRoundsPlayed >= SoakRoundCount) {
+			SampleSoakMemory();
+		}
+		if (SoakRoundsPlayed >= SoakRoundCount) {
+			FinishSoak();
+			if (bExitAfterSoak) {
+				FPlatformMisc::RequestExit(false);
+				return;
+			}
+		}
+	}
+
+	// Element type is trivially destructible, so this is O(1) and keeps the memory
+	PendingRespawns.Reset();
+
+	FighterGameState->RoundNumber++;
+	FighterGameState->RoundTimeRemaining = RoundTime;
+	FighterGameState->RoundWinner = nullptr;
+	FighterGameState->bRoundInProgress = true;
+
+	for (APlayerState* Player : FighterGameState->PlayerArray) {
+		if (AMedievalFighterPlayerState* Fighter = Cast<AMedievalFighterPlayerState>(Player)) {
+			Fighter->ResetRoundStats();
+		}
+	}
+
+	for (FConstControllerIterator Iterator = GetWorld()->GetControllerIterator(); Iterator; ++Iterator) {
+		if (AController* Controller = Iterator->Get()) {
+			RespawnFighter(Controller);
+		}
+	}
+
+	GetWorldTimerManager().ClearTimer(NextRoundTimerHandle);
+	GetWorldTimerManager().SetTimer(RoundTimerHandle, this, &AMedievalFighterGameMode::RoundTick, 1.0f, true);
+}
+void AMedievalFighterGameMode::RoundTick()
+{
+	AMedievalFighterGameState* FighterGameState = GetFighterGameState();
+	if (FighterGameState == nullptr || !FighterGameState->bRoundInProgress) {
+		return;
+	}
+
+	// Respawn everyone whose delay has passed
+	const float Now = GetWorld()->GetTimeSeconds();
+	for (int32 Index = PendingRespawns.Num() - 1; Index >= 0; Index--) {
+		if (PendingRespawns[Index].RespawnTime <= Now) {
+			if (AController* Controller = PendingRespawns[Index].Controller.Get()) {
+				RespawnFighter(Controller);
+			}
+			PendingRespawns.RemoveAtSwap(Index, 1, false);
+		}
+	}
+
+	if (SoakRoundCount > 0) {
+		SoakKill();
+	}
+
+	FighterGameState->RoundTimeRemaining--;
+	if (FighterGameState->RoundTimeRemaining <= 0) {
+		EndRound();
+	}
+}
+void AMedievalFighterGameMode::EndRound()
+{
+	AMedievalFighterGameState* FighterGameState = GetFighterGameState();
+	if (FighterGameState == nullptr || !FighterGameState->bRoundInProgress) {
+		return;
+	}
+
+	FighterGameState->bRoundInProgress = false;
+	FighterGameState->RoundTimeRemaining = 0;
+
+	// A tie at the top is a draw
+	AMedievalFighterPlayerState* Leader = nullptr;
+	int32 RunnerUpKills = -1;
+	for (APlayerState* Player : FighterGameState->PlayerArray) {
+		AMedievalFighterPlayerState* Fighter = Cast<AMedievalFighterPlayerState>(Player);
+		if (Fighter == nullptr) {
+			continue;
+		}
+
+		if (Leader == nullptr || Fighter->Kills > Leader->Kills) {
+			RunnerUpKills = Leader != nullptr ? Leader->Kills : RunnerUpKills;
+			Leader = Fighter;
+		}
+		else {
+			RunnerUpKills = FMath::Max(RunnerUpKills, Fighter->Kills);
+		}
+	}
+	if (Leader != nullptr && Leader->Kills > RunnerUpKills) {
+		FighterGameState->RoundWinner = Leader;
+	}
+
+	if (SoakRoundCount > 0) {
+		SoakRoundsPlayed++;
+		// Collect before the next round starts, so its memory sample only holds live objects
+		GEngine->ForceGarbageCollection(true);
+	}
+
+	GetWorldTimerManager().ClearTimer(RoundTimerHandle);
+	GetWorldTimerManager().SetTimer(NextRoundTimerHandle, this, &AMedievalFighterGameMode::StartRound, RoundEndDelay, false);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Death and Respawn
+//////////////////////////////////////////////////////////////////////////
+void AMedievalFighterGameMode::FighterKilled(AMedievalFighterCharacter* Victim, AMedievalFighterCharacter* Killer)
+{
+	AMedievalFighterGameState* FighterGameState = GetFighterGameState();
+	AController* VictimController = Victim->GetController();
+	AController* KillerController = Killer != nullptr ? Killer->GetController() : nullptr;
+
+	if (VictimController != nullptr) {
+		if (AMedievalFighterPlayerState* VictimState = VictimController->GetPlayerState<AMedievalFighterPlayerState>()) {
+			VictimState->AddDeath();
+		}
+
+		FPendingRespawn& Respawn = PendingRespawns.AddDefaulted_GetRef();
+		Respawn.Controller = VictimController;
+		Respawn.RespawnTime = GetWorld()->GetTimeSeconds() + RespawnDelay;
+	}
+
+	// The body stays possessed and is revived in place when the delay runs out
+	if (FighterGameState == nullptr || !FighterGameState->bRoundInProgress) {
+		return;
+	}
+
+	if (KillerController != nullptr && KillerController != VictimController) {
+		if (AMedievalFighterPlayerState* KillerState = KillerController->GetPlayerState<AMedievalFighterPlayerState>()) {
+			KillerState->AddKill();
+
+			if (ScoreLimit > 0 && KillerState->Kills >= ScoreLimit) {
+				EndRound();
+			}
+		}
+	}
+}
+void AMedievalFighterGameMode::RespawnFighter(AController* Controller)
+{
+	// Reuse the fighter rather than destroying and spawning a pawn every death and round
+	if (AMedievalFighterCharacter* Fighter = Cast<AMedievalFighterCharacter>(Controller->GetPawn())) {
+		if (AActor* StartSpot = ChoosePlayerStart(Controller)) {
+			Fighter->Revive(StartSpot->GetActorTransform());
+			return;
+		}
+	}
+
+	if (APawn* OldPawn = Controller->GetPawn()) {
+		Controller->UnPossess();
+		OldPawn->Destroy();
+	}
+
+	RestartPlayer(Controller);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Soak Testing
+//////////////////////////////////////////////////////////////////////////
+void AMedievalFighterGameMode::SoakRounds(int32 Rounds, int32 Bots)
+{
+	if (SoakRoundCount > 0) {
+		UE_LOG(LogMedievalFighterGameMode, Warning, TEXT("A soak of %d rounds is already running, %d played"), SoakRoundCount, SoakRoundsPlayed);
+		return;
+	}
+	if (Rounds <= 0) {
+		return;
+	}
+
+	SavedRoundTime = RoundTime;
+	SavedRespawnDelay = RespawnDelay;
+	SavedRoundEndDelay = RoundEndDelay;
+	RoundTime = SoakRoundTime;
+	RespawnDelay = 1.0f;
+	RoundEndDelay = 1.0f;
+
+	// Bots get their fighters when the next round starts
+	for (int32 Index = 0; Index < Bots; Index++) {
+		SoakBots.Add(GetWorld()->SpawnActor<AMedievalFighterBotController>());
+	}
+	SoakFighters.Reserve(Bots + GetNumPlayers());
+
+	SoakRoundCount = Rounds;
+	SoakRoundsPlayed = 0;
+	SoakBaselineMemory = 0;
+	SoakLastMemory = 0;
+
+	UE_LOG(LogMedievalFighterGameMode, Log, TEXT("Soaking %d rounds of %d seconds with %d bots, sampling every %d rounds"), Rounds, RoundTime, Bots, SoakSampleRounds);
+
+	// Restart straight away with the bots, the interrupted round doesn't count
+	StartRound();
+}
+void AMedievalFighterGameMode::SoakKill()
+{
+	SoakFighters.Reset();
+	for (TActorIterator<AMedievalFighterCharacter> It(GetWorld()); It; ++It) {
+		if (!It->IsDead()) {
+			SoakFighters.Add(*It);
+		}
+	}
+
+	if (SoakFighters.Num() < 2) {
+		return;
+	}
+
+	const int32 VictimIndex = FMath::RandHelper(SoakFighters.Num());
+	const int32 KillerIndex = (VictimIndex + 1 + FMath::RandHelper(SoakFighters.Num() - 1)) % SoakFighters.Num();
+	SoakFighters[VictimIndex]->TakeDamage(BIG_NUMBER, SoakFighters[KillerIndex]);
+}
+void AMedievalFighterGameMode::SampleSoakMemory()
+{
+	const uint64 Used = FPlatformMemory::GetStats().UsedPhysical;
+
+	// The first sample is taken after SoakSampleRounds rounds, once pools and caches have warmed up
+	if (SoakRoundsPlayed == 0) {
+		return;
+	}
+	if (SoakBaselineMemory == 0) {
+		SoakBaselineMemory = Used;
+		SoakLastMemory = Used;
+	}
+
+	UE_LOG(LogMedievalFighterGameMode, Log, TEXT("Soak round %d/%d: used physical %llu KB, %+lld KB since last sample, %+lld KB since baseline, %d fighters"),
+		SoakRoundsPlayed, SoakRoundCount, Used / 1024,
+		(int64(Used) - int64(SoakLastMemory)) / 1024, (int64(Used) - int64(SoakBaselineMemory)) / 1024,
+		FCombatBroadphase::Get(GetWorld()).Num());
+
+	SoakLastMemory = Used;
+}
+void AMedievalFighterGameMode::FinishSoak()
+{
+	const int64 GrowthKB = (int64(SoakLastMemory) - int64(SoakBaselineMemory)) / 1024;
+	if (GrowthKB > int64(SoakMaxGrowthMB) * 1024) {
+		UE_LOG(LogMedievalFighterGameMode, Error, TEXT("Soak of %d rounds grew used physical memory by %lld KB, over the %d MB limit"), SoakRoundsPlayed, GrowthKB, SoakMaxGrowthMB);
+	}
+	else {
+		UE_LOG(LogMedievalFighterGameMode, Log, TEXT("Soak of %d rounds grew used physical memory by %lld KB"), SoakRoundsPlayed, GrowthKB);
+	}
+
+	for (const TWeakObjectPtr<AController>& Bot : SoakBots) {
+		if (AController* Controller = Bot.Get()) {
+			if (APawn* Pawn = Controller->GetPawn()) {
+				Pawn->Destroy();
+			}
+			Controller->Destroy();
+		}
+	}
+	SoakBots.Empty();
+	SoakFighters.Empty();
+
+	RoundTime = SavedRoundTime;
+	RespawnDelay = SavedRespawnDelay;
+	RoundEndDelay = SavedRoundEndDelay;
+	SoakRoundCount = 0;
+}
@@ -0,0 +1,124 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/GameModeBase.h"
+#include "MedievalFighterGameMode.generated.h"
+
+class AMedievalFighterCharacter;
+class AMedievalFighterGameState;
+class AMedievalFighterPlayerState;
+
+/** A fighter waiting to respawn during the current round */
+struct FPendingRespawn
+{
+	TWeakObjectPtr<AController> Controller;
+	float RespawnTime;
+};
+
+UCLASS(config=Game)
+class AMedievalFighterGameMode : public AGameModeBase
+{
+	GENERATED_BODY()
+
+public:
+	AMedievalFighterGameMode();
+
+	//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Config
+	//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	/** Pawn spawned for every player */
+	UPROPERTY(config, EditDefaultsOnly, Category = "Round")
+		TSoftClassPtr<APawn> FighterClass;
+	/** Length of a round in seconds */
+	UPROPERTY(config, EditDefaultsOnly, Category = "Round")
+		int32 RoundTime;
+	/** Kills needed to end a round early, 0 for no limit */
+	UPROPERTY(config, EditDefaultsOnly, Category = "Round")
+		int32 ScoreLimit;
+	/** Seconds a dead fighter waits before respawning */
+	UPROPERTY(config, EditDefaultsOnly, Category = "Round")
+		float RespawnDelay;
+	/** Seconds between the end of a round and the start of the next one */
+	UPROPERTY(config, EditDefaultsOnly, Category = "Round")
+		float RoundEndDelay;
+
+	/** Length of a round while soak testing */
+	UPROPERTY(config, EditDefaultsOnly, Category = "Soak")
+		int32 SoakRoundTime;
+	/** Memory is sampled every this many soak rounds, the first sample is the baseline */
+	UPROPERTY(config, EditDefaultsOnly, Category = "Soak")
+		int32 SoakSampleRounds;
+	/** Growth over the baseline, in MB, reported as an error at the end of a soak */
+	UPROPERTY(config, EditDefaultsOnly, Category = "Soak")
+		int32 SoakMaxGrowthMB;
+
+	/** Returns the class defaults of FighterClass, or of the native fighter if none is configured */
+	static const AMedievalFighterCharacter* GetFighterDefaults();
+
+	/** Called by a fighter on the server when its health runs out */
+	void FighterKilled(AMedievalFighterCharacter* Victim, AMedievalFighterCharacter* Killer);
+
+	/** Ends the current round and schedules the next one */
+	UFUNCTION(BlueprintCallable, Category = "Round")
+		void EndRound();
+
+	/**
+	 * Plays real rounds back to back with bots killing each other, and logs memory every SoakSampleRounds rounds
+	 * after a garbage collection. Also started by -SoakRounds=N on the command line, which exits when done.
+	 */
+	UFUNCTION(Exec, Category = "Soak")
+		void SoakRounds(int32 Rounds, int32 Bots = 8);
+
+protected:
+	//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Timer handles
+	//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	FTimerHandle RoundTimerHandle;
+	FTimerHandle NextRoundTimerHandle;
+
+	//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Per round data
+	//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Reserved once and reset without freeing
+	TArray<FPendingRespawn> PendingRespawns;
+
+	//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Soak testing
+	//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	int32 SoakRoundCount;
+	int32 SoakRoundsPlayed;
+	uint64 SoakBaselineMemory;
+	uint64 SoakLastMemory;
+	bool bExitAfterSoak;
+	/** Round config replaced while soaking */
+	int32 SavedRoundTime;
+	float SavedRespawnDelay;
+	float SavedRoundEndDelay;
+	TArray<TWeakObjectPtr<AController>> SoakBots;
+	/** Living fighters, gathered each soak kill */
+	TArray<AMedievalFighterCharacter*> SoakFighters;
+
+	/** Starts a new round, respawning everyone */
+	void StartRound();
+	/** Counts the round down once a second and respawns dead fighters */
+	void RoundTick();
+	/** Revives a controller's fighter at a player start, or spawns one if it has none */
+	void RespawnFighter(AController* Controller);
+
+	/** Has one living fighter kill another */
+	void SoakKill();
+	/** Logs memory against the previous sample and the baseline */
+	void SampleSoakMemory();
+	/** Restores the round config and removes the bots */
+	void FinishSoak();
+
+	AMedievalFighterGameState* GetFighterGameState() const;
+
+public:
+	// AGameModeBase interface
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+	virtual void StartPlay() override;
+	// End of AGameModeBase interface
+};
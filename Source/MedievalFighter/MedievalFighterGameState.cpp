@@ -0,0 +1,47 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "MedievalFighterGameState.h"
+#include "MedievalFighterPlayerState.h"
+#include "Net/UnrealNetwork.h"
+
+AMedievalFighterGameState::AMedievalFighterGameState()
+{
+	RoundNumber = 0;
+	RoundTimeRemaining = 0;
+	bRoundInProgress = false;
+	RoundWinner = nullptr;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Multiplayer Variable Replication
+//////////////////////////////////////////////////////////////////////////
+void AMedievalFighterGameState::GetLifetimeReplicatedProps(TArray< FLifetimeProperty >& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// Replicate to everyone
+	DOREPLIFETIME(AMedievalFighterGameState, RoundNumber);
+	DOREPLIFETIME(AMedievalFighterGameState, RoundTimeRemaining);
+	DOREPLIFETIME(AMedievalFighterGameState, bRoundInProgress);
+	DOREPLIFETIME(AMedievalFighterGameState, RoundWinner);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Scoreboard
+//////////////////////////////////////////////////////////////////////////
+TArray<AMedievalFighterPlayerState*> AMedievalFighterGameState::GetScoreboard() const
+{
+	TArray<AMedievalFighterPlayerState*> Scoreboard;
+	Scoreboard.Reserve(PlayerArray.Num());
+
+	for (APlayerState* Player : PlayerArray) {
+		if (AMedievalFighterPlayerState* Fighter = Cast<AMedievalFighterPlayerState>(Player)) {
+			Scoreboard.Add(Fighter);
+		}
+	}
+
+	Scoreboard.Sort([](const AMedievalFighterPlayerState& A, const AMedievalFighterPlayerState& B) {
+		return A.Kills != B.Kills ? A.Kills > B.Kills : A.Deaths < B.Deaths;
+	});
+	return Scoreboard;
+}
@@ -0,0 +1,35 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/GameStateBase.h"
+#include "MedievalFighterGameState.generated.h"
+
+class AMedievalFighterPlayerState;
+
+UCLASS()
+class AMedievalFighterGameState : public AGameStateBase
+{
+	GENERATED_BODY()
+
+public:
+	AMedievalFighterGameState();
+
+	/** Current round, starting at 1 */
+	UPROPERTY(Replicated, BlueprintReadOnly, Category = "Multiplayer Round")
+		int32 RoundNumber;
+	/** Seconds left in the current round */
+	UPROPERTY(Replicated, BlueprintReadOnly, Category = "Multiplayer Round")
+		int32 RoundTimeRemaining;
+	/** True while fighters can score */
+	UPROPERTY(Replicated, BlueprintReadOnly, Category = "Multiplayer Round")
+		bool bRoundInProgress;
+	/** Winner of the last finished round, null on a draw */
+	UPROPERTY(Replicated, BlueprintReadOnly, Category = "Multiplayer Round")
+		AMedievalFighterPlayerState* RoundWinner;
+
+	/** Returns players sorted by kills, then by fewest deaths */
+	UFUNCTION(BlueprintCallable, Category = "Multiplayer Scoreboard")
+		TArray<AMedievalFighterPlayerState*> GetScoreboard() const;
+};
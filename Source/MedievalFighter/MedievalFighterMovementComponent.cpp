@@ -0,0 +1,286 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "MedievalFighterMovementComponent.h"
+#include "MedievalFighter.h"
+#include "GameFramework/Character.h"
+
+DECLARE_CYCLE_STAT(TEXT("Server Move Batch"), STAT_ServerMoveBatch, STATGROUP_MedievalFighter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Server Moves Processed"), STAT_ServerMovesProcessed, STATGROUP_MedievalFighter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Server Moves Deferred"), STAT_ServerMovesDeferred, STATGROUP_MedievalFighter);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Server Moves Dropped"), STAT_ServerMovesDropped, STATGROUP_MedievalFighter);
+
+double UMedievalFighterMovementComponent::TotalServerMoveSeconds = 0.0;
+int64 UMedievalFighterMovementComponent::TotalServerMoves = 0;
+
+namespace
+{
+	const int32 AccelerationHeadingSteps = 1 << 10;
+	const int32 AccelerationMagnitudeSteps = (1 << 6) - 1;
+
+	/** Fighters of one world with queued moves, served in turn under one budget */
+	struct FServerMoveSchedule
+	{
+		TArray<TWeakObjectPtr<UMedievalFighterMovementComponent>> Fighters;
+		int32 NextFighter = 0;
+		uint64 LastFrame = 0;
+	};
+	TMap<const UWorld*, FServerMoveSchedule> WorldSchedules;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Saved Moves
+//////////////////////////////////////////////////////////////////////////
+FSavedMove_MedievalFighter::FSavedMove_MedievalFighter()
+	: PackedAcceleration(0)
+	, bHasPackedAcceleration(false)
+{
+}
+void FSavedMove_MedievalFighter::Clear()
+{
+	Super::Clear();
+
+	PackedAcceleration = 0;
+	bHasPackedAcceleration = false;
+}
+void FSavedMove_MedievalFighter::SetMoveFor(ACharacter* Character, float InDeltaTime, FVector const& NewAccel, class FNetworkPredictionData_Client_Character& ClientData)
+{
+	Super::SetMoveFor(Character, InDeltaTime, NewAccel, ClientData);
+
+	// Packed from the same input RoundAcceleration saw, so the server unpacks exactly the simulated Acceleration
+	const UMedievalFighterMovementComponent* Movement = Cast<UMedievalFighterMovementComponent>(Character->GetCharacterMovement());
+	bHasPackedAcceleration = Movement != nullptr && Movement->PackAcceleration(NewAccel, PackedAcceleration);
+}
+FNetworkPredictionData_Client_MedievalFighter::FNetworkPredictionData_Client_MedievalFighter(const UCharacterMovementComponent& ClientMovement)
+	: Super(ClientMovement)
+{
+}
+FSavedMovePtr FNetworkPredictionData_Client_MedievalFighter::AllocateNewMove()
+{
+	return FSavedMovePtr(new FSavedMove_MedievalFighter());
+}
+
+//////////////////////////////////////////////////////////////////////////
+// UMedievalFighterMovementComponent
+//////////////////////////////////////////////////////////////////////////
+UMedievalFighterMovementComponent::UMedievalFighterMovementComponent()
+{
+	bBatchServerMoves = true;
+	ServerMoveBudgetMs = 2.0f;
+	MaxQueuedServerMoves = 16;
+}
+FNetworkPredictionData_Client* UMedievalFighterMovementComponent::GetPredictionData_Client() const
+{
+	if (ClientPredictionData == nullptr) {
+		UMedievalFighterMovementComponent* MutableThis = const_cast<UMedievalFighterMovementComponent*>(this);
+		MutableThis->ClientPredictionData = new FNetworkPredictionData_Client_MedievalFighter(*this);
+	}
+
+	return ClientPredictionData;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Acceleration Packing
+//////////////////////////////////////////////////////////////////////////
+bool UMedievalFighterMovementComponent::PackAcceleration(const FVector& Accel, uint16& OutPacked) const
+{
+	const float MaxAccel = GetMaxAcceleration();
+	if (MaxAccel <= 0.0f || !FMath::IsNearlyZero(Accel.Z)) {
+		return false;
+	}
+
+	const float Size2D = Accel.Size2D();
+	const int32 Magnitude = FMath::Clamp(FMath::RoundToInt(Size2D / MaxAccel * AccelerationMagnitudeSteps), 0, AccelerationMagnitudeSteps);
+	const int32 Heading = Magnitude > 0 ? FMath::RoundToInt(FMath::Atan2(Accel.Y, Accel.X) / (2.0f * PI) * AccelerationHeadingSteps) & (AccelerationHeadingSteps - 1) : 0;
+
+	OutPacked = uint16((Heading << 6) | Magnitude);
+	return true;
+}
+FVector UMedievalFighterMovementComponent::UnpackAcceleration(uint16 Packed) const
+{
+	const float Heading = float(Packed >> 6) * (2.0f * PI / AccelerationHeadingSteps);
+	const float Magnitude = float(Packed & AccelerationMagnitudeSteps) * GetMaxAcceleration() / AccelerationMagnitudeSteps;
+
+	return Super::RoundAcceleration(FVector(FMath::Cos(Heading) * Magnitude, FMath::Sin(Heading) * Magnitude, 0.0f));
+}
+FVector UMedievalFighterMovementComponent::RoundAcceleration(FVector InAccel) const
+{
+	// Simulate exactly what the packed move carries, 0.35 degrees of heading and 1/63 of full input at worst
+	uint16 Packed;
+	if (PackAcceleration(InAccel, Packed)) {
+		return UnpackAcceleration(Packed);
+	}
+
+	return Super::RoundAcceleration(InAccel);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Client
+//////////////////////////////////////////////////////////////////////////
+void UMedievalFighterMovementComponent::CallServerMove(const FSavedMove_Character* NewMove, const FSavedMove_Character* OldMove)
+{
+	const FSavedMove_MedievalFighter* FighterMove = static_cast<const FSavedMove_MedievalFighter*>(NewMove);
+	const FNetworkPredictionData_Client_Character* ClientData = GetPredictionData_Client_Character();
+
+	// Dual moves and moves with vertical acceleration go through the stock RPCs
+	if (!FighterMove->bHasPackedAcceleration || ClientData->PendingMove.IsValid()) {
+		Super::CallServerMove(NewMove, OldMove);
+		return;
+	}
+
+	uint32 ClientYawPitch = 0;
+	uint8 ClientRoll = 0;
+	NewMove->GetPackedAngles(ClientYawPitch, ClientRoll);
+
+	UPrimitiveComponent* ClientMovementBase = NewMove->EndBase.Get();
+	const FVector SendLocation = MovementBaseUtility::UseRelativeLocation(ClientMovementBase) ? NewMove->SavedRelativeLocation : FRepMovement::RebaseOntoZeroOrigin(NewMove->SavedLocation, this);
+
+	if (OldMove != nullptr) {
+		ServerMoveOld(OldMove->TimeStamp, OldMove->Acceleration, OldMove->GetCompressedFlags());
+	}
+
+	ServerMovePacked(NewMove->TimeStamp, FighterMove->PackedAcceleration, SendLocation, NewMove->GetCompressedFlags(), ClientRoll, ClientYawPitch, ClientMovementBase, NewMove->EndBoneName, NewMove->EndPackedMovementMode);
+
+	MarkForClientCameraUpdate();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Server
+//////////////////////////////////////////////////////////////////////////
+void UMedievalFighterMovementComponent::ServerMovePacked_Implementation(float TimeStamp, uint16 PackedAccel, FVector_NetQuantize100 ClientLoc, uint8 CompressedMoveFlags, uint8 ClientRoll, uint32 View, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode)
+{
+	ServerMove_Implementation(TimeStamp, UnpackAcceleration(PackedAccel), ClientLoc, CompressedMoveFlags, ClientRoll, View, ClientMovementBase, ClientBaseBoneName, ClientMovementMode);
+}
+bool UMedievalFighterMovementComponent::ServerMovePacked_Validate(float TimeStamp, uint16 PackedAccel, FVector_NetQuantize100 ClientLoc, uint8 CompressedMoveFlags, uint8 ClientRoll, uint32 View, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode)
+{
+	return true;
+}
+void UMedievalFighterMovementComponent::ServerMove_Implementation(float TimeStamp, FVector_NetQuantize10 InAccel, FVector_NetQuantize100 ClientLoc, uint8 CompressedMoveFlags, uint8 ClientRoll, uint32 View, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode)
+{
+	if (!bBatchServerMoves) {
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		Super::ServerMove_Implementation(TimeStamp, InAccel, ClientLoc, CompressedMoveFlags, ClientRoll, View, ClientMovementBase, ClientBaseBoneName, ClientMovementMode);
+
+		TotalServerMoveSeconds += FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles);
+		TotalServerMoves++;
+		return;
+	}
+
+	FQueuedServerMove Move;
+	Move.bOldMove = false;
+	// Set by ServerMoveDualHybridRootMotion around its first move only
+	Move.bIgnoreRootMotion = CharacterOwner->bServerMoveIgnoreRootMotion;
+	Move.TimeStamp = TimeStamp;
+	Move.Accel = InAccel;
+	Move.ClientLoc = ClientLoc;
+	Move.CompressedMoveFlags = CompressedMoveFlags;
+	Move.ClientRoll = ClientRoll;
+	Move.View = View;
+	Move.ClientMovementBase = ClientMovementBase;
+	Move.ClientBaseBoneName = ClientBaseBoneName;
+	Move.ClientMovementMode = ClientMovementMode;
+	QueueServerMove(Move);
+}
+void UMedievalFighterMovementComponent::ServerMoveOld_Implementation(float OldTimeStamp, FVector_NetQuantize10 OldAccel, uint8 OldMoveFlags)
+{
+	if (!bBatchServerMoves) {
+		Super::ServerMoveOld_Implementation(OldTimeStamp, OldAccel, OldMoveFlags);
+		return;
+	}
+
+	// Queued too, old moves must run in arrival order with the moves around them
+	FQueuedServerMove Move;
+	Move.bOldMove = true;
+	Move.bIgnoreRootMotion = false;
+	Move.TimeStamp = OldTimeStamp;
+	Move.Accel = OldAccel;
+	Move.CompressedMoveFlags = OldMoveFlags;
+	QueueServerMove(Move);
+}
+void UMedievalFighterMovementComponent::QueueServerMove(const FQueuedServerMove& Move)
+{
+	if (QueuedServerMoves.Num() == 0) {
+		WorldSchedules.FindOrAdd(GetWorld()).Fighters.Add(this);
+	}
+
+	// A client that outruns the budget loses its oldest moves, the next move covers their time like after packet loss
+	if (QueuedServerMoves.Num() >= FMath::Max(MaxQueuedServerMoves, 1)) {
+		QueuedServerMoves.RemoveAt(0, 1, false);
+		INC_DWORD_STAT(STAT_ServerMovesDropped);
+	}
+
+	QueuedServerMoves.Add(Move);
+}
+void UMedievalFighterMovementComponent::ProcessOldestServerMove()
+{
+	const FQueuedServerMove Move = QueuedServerMoves[0];
+	QueuedServerMoves.RemoveAt(0, 1, false);
+
+	if (Move.bOldMove) {
+		Super::ServerMoveOld_Implementation(Move.TimeStamp, Move.Accel, Move.CompressedMoveFlags);
+		return;
+	}
+
+	CharacterOwner->bServerMoveIgnoreRootMotion = Move.bIgnoreRootMotion;
+	Super::ServerMove_Implementation(Move.TimeStamp, Move.Accel, Move.ClientLoc, Move.CompressedMoveFlags, Move.ClientRoll, Move.View, Move.ClientMovementBase.Get(), Move.ClientBaseBoneName, Move.ClientMovementMode);
+	CharacterOwner->bServerMoveIgnoreRootMotion = false;
+}
+void UMedievalFighterMovementComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	// Whichever fighter ticks first runs the batch for the whole world
+	if (bBatchServerMoves && GetOwnerRole() == ROLE_Authority) {
+		ProcessServerMoveBatch(GetWorld());
+	}
+
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+}
+void UMedievalFighterMovementComponent::ProcessServerMoveBatch(const UWorld* World)
+{
+	FServerMoveSchedule* Schedule = WorldSchedules.Find(World);
+	if (Schedule == nullptr || Schedule->LastFrame == GFrameCounter) {
+		return;
+	}
+	Schedule->LastFrame = GFrameCounter;
+
+	SCOPE_CYCLE_COUNTER(STAT_ServerMoveBatch);
+
+	const double BudgetSeconds = GetDefault<UMedievalFighterMovementComponent>()->ServerMoveBudgetMs / 1000.0;
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	double ElapsedSeconds = 0.0;
+	int32 Processed = 0;
+
+	// One move per fighter in turn, so a flooding client can't starve the others. Each tick picks up
+	// where the last one stopped, and the budget can only be overrun by the one move that crosses it
+	while (Schedule->Fighters.Num() > 0 && ElapsedSeconds < BudgetSeconds) {
+		if (Schedule->NextFighter >= Schedule->Fighters.Num()) {
+			Schedule->NextFighter = 0;
+		}
+
+		UMedievalFighterMovementComponent* Fighter = Schedule->Fighters[Schedule->NextFighter].Get();
+		if (Fighter != nullptr && Fighter->QueuedServerMoves.Num() > 0) {
+			Fighter->ProcessOldestServerMove();
+			Processed++;
+			ElapsedSeconds = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - StartCycles);
+		}
+
+		if (Fighter == nullptr || Fighter->QueuedServerMoves.Num() == 0) {
+			Schedule->Fighters.RemoveAt(Schedule->NextFighter, 1, false);
+		}
+		else {
+			Schedule->NextFighter++;
+		}
+	}
+
+	TotalServerMoveSeconds += ElapsedSeconds;
+	TotalServerMoves += Processed;
+	INC_DWORD_STAT_BY(STAT_ServerMovesProcessed, Processed);
+
+	int32 Deferred = 0;
+	for (const TWeakObjectPtr<UMedievalFighterMovementComponent>& Fighter : Schedule->Fighters) {
+		Deferred += Fighter.IsValid() ? Fighter->QueuedServerMoves.Num() : 0;
+	}
+	INC_DWORD_STAT_BY(STAT_ServerMovesDeferred, Deferred);
+
+	if (Schedule->Fighters.Num() == 0) {
+		WorldSchedules.Remove(World);
+	}
+}
@@ -0,0 +1,110 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "MedievalFighterMovementComponent.generated.h"
+
+/** Saved move that keeps its acceleration in the 16 bit form sent by ServerMovePacked */
+class FSavedMove_MedievalFighter : public FSavedMove_Character
+{
+	typedef FSavedMove_Character Super;
+
+public:
+	FSavedMove_MedievalFighter();
+
+	/** Heading and magnitude of the acceleration, see UMedievalFighterMovementComponent::PackAcceleration */
+	uint16 PackedAcceleration;
+	/** False when the acceleration has no packed form, the stock ServerMove is sent instead */
+	bool bHasPackedAcceleration;
+
+	virtual void Clear() override;
+	virtual void SetMoveFor(ACharacter* Character, float InDeltaTime, FVector const& NewAccel, class FNetworkPredictionData_Client_Character& ClientData) override;
+};
+
+class FNetworkPredictionData_Client_MedievalFighter : public FNetworkPredictionData_Client_Character
+{
+	typedef FNetworkPredictionData_Client_Character Super;
+
+public:
+	FNetworkPredictionData_Client_MedievalFighter(const UCharacterMovementComponent& ClientMovement);
+
+	virtual FSavedMovePtr AllocateNewMove() override;
+};
+
+/** A client move received by the server, waiting for its turn in the world's move budget */
+struct FQueuedServerMove
+{
+	/** Sent through ServerMoveOld, only the time stamp, acceleration and flags are set */
+	bool bOldMove;
+	bool bIgnoreRootMotion;
+	float TimeStamp;
+	FVector_NetQuantize10 Accel;
+	FVector_NetQuantize100 ClientLoc;
+	uint8 CompressedMoveFlags;
+	uint8 ClientRoll;
+	uint32 View;
+	TWeakObjectPtr<UPrimitiveComponent> ClientMovementBase;
+	FName ClientBaseBoneName;
+	uint8 ClientMovementMode;
+};
+
+UCLASS(config=Game)
+class UMedievalFighterMovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+public:
+	UMedievalFighterMovementComponent();
+
+	//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Server
+	//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	/** Queue client moves and process them under one budget per world each tick */
+	UPROPERTY(config, EditDefaultsOnly, Category = "Network")
+		bool bBatchServerMoves;
+	/** Milliseconds the server may spend per tick on the queued moves of all fighters together, read from the class defaults */
+	UPROPERTY(config, EditDefaultsOnly, Category = "Network")
+		float ServerMoveBudgetMs;
+	/** Moves a fighter may have queued, the oldest is dropped past this like a lost packet */
+	UPROPERTY(config, EditDefaultsOnly, Category = "Network")
+		int32 MaxQueuedServerMoves;
+
+	/** Seconds the server has spent processing client moves, across every fighter */
+	static double TotalServerMoveSeconds;
+	/** Client moves the server has processed, across every fighter */
+	static int64 TotalServerMoves;
+
+	/** Packs a horizontal acceleration into 10 bits of heading and 6 of magnitude, false if it has a vertical part */
+	bool PackAcceleration(const FVector& Accel, uint16& OutPacked) const;
+	/** Returns the acceleration a packed value stands for, rounded like any sent acceleration */
+	FVector UnpackAcceleration(uint16 Packed) const;
+
+	/** ServerMove with the acceleration packed into 16 bits */
+	UFUNCTION(Unreliable, Server, WithValidation)
+		void ServerMovePacked(float TimeStamp, uint16 PackedAccel, FVector_NetQuantize100 ClientLoc, uint8 CompressedMoveFlags, uint8 ClientRoll, uint32 View, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode);
+		void ServerMovePacked_Implementation(float TimeStamp, uint16 PackedAccel, FVector_NetQuantize100 ClientLoc, uint8 CompressedMoveFlags, uint8 ClientRoll, uint32 View, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode);
+		bool ServerMovePacked_Validate(float TimeStamp, uint16 PackedAccel, FVector_NetQuantize100 ClientLoc, uint8 CompressedMoveFlags, uint8 ClientRoll, uint32 View, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode);
+
+	// UCharacterMovementComponent interface
+	virtual FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+	virtual FVector RoundAcceleration(FVector InAccel) const override;
+	virtual void CallServerMove(const FSavedMove_Character* NewMove, const FSavedMove_Character* OldMove) override;
+	virtual void ServerMove_Implementation(float TimeStamp, FVector_NetQuantize10 InAccel, FVector_NetQuantize100 ClientLoc, uint8 CompressedMoveFlags, uint8 ClientRoll, uint32 View, UPrimitiveComponent* ClientMovementBase, FName ClientBaseBoneName, uint8 ClientMovementMode) override;
+	virtual void ServerMoveOld_Implementation(float OldTimeStamp, FVector_NetQuantize10 OldAccel, uint8 OldMoveFlags) override;
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	// End of UCharacterMovementComponent interface
+
+protected:
+	/** Moves received and not processed yet, oldest first */
+	TArray<FQueuedServerMove> QueuedServerMoves;
+
+	/** Adds a received move to the queue and schedules this fighter */
+	void QueueServerMove(const FQueuedServerMove& Move);
+	/** Runs the oldest queued move */
+	void ProcessOldestServerMove();
+
+	/** Runs queued moves of every fighter in the world round robin until the budget is spent, once per frame */
+	static void ProcessServerMoveBatch(const UWorld* World);
+};
@@ -0,0 +1,41 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#include "MedievalFighterPlayerState.h"
+#include "Net/UnrealNetwork.h"
+
+AMedievalFighterPlayerState::AMedievalFighterPlayerState()
+{
+	Kills = 0;
+	Deaths = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Multiplayer Variable Replication
+//////////////////////////////////////////////////////////////////////////
+void AMedievalFighterPlayerState::GetLifetimeReplicatedProps(TArray< FLifetimeProperty >& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// Replicate to everyone
+	DOREPLIFETIME(AMedievalFighterPlayerState, Kills);
+	DOREPLIFETIME(AMedievalFighterPlayerState, Deaths);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Scoreboard
+//////////////////////////////////////////////////////////////////////////
+void AMedievalFighterPlayerState::AddKill()
+{
+	Kills++;
+	Score = Kills;
+}
+void AMedievalFighterPlayerState::AddDeath()
+{
+	Deaths++;
+}
+void AMedievalFighterPlayerState::ResetRoundStats()
+{
+	Kills = 0;
+	Deaths = 0;
+	Score = 0.0f;
+}
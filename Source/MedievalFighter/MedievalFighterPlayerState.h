@@ -0,0 +1,30 @@
+// Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/PlayerState.h"
+#include "MedievalFighterPlayerState.generated.h"
+
+UCLASS()
+class AMedievalFighterPlayerState : public APlayerState
+{
+	GENERATED_BODY()
+
+public:
+	AMedievalFighterPlayerState();
+
+	/** Kills this round */
+	UPROPERTY(Replicated, BlueprintReadOnly, Category = "Multiplayer Scoreboard")
+		int32 Kills;
+	/** Deaths this round */
+	UPROPERTY(Replicated, BlueprintReadOnly, Category = "Multiplayer Scoreboard")
+		int32 Deaths;
+
+	/** Adds a kill and updates the score */
+	void AddKill();
+	/** Adds a death */
+	void AddDeath();
+	/** Clears kills, deaths and score for a new round */
+	void ResetRoundStats();
+};